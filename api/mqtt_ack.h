@@ -0,0 +1,85 @@
+#ifndef __MQTT_ACK_H__
+#define __MQTT_ACK_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Length of PUBACK packet without Reason Code */
+#define MQTT_ACK_PUBACK_LEN   4
+
+typedef struct {
+  /** Packet Identifiers of the deferred messages */
+  uint16_t *ids;
+  /** Maximum number of the deferred messages */
+  size_t capacity;
+  /** Number of the deferred messages */
+  size_t length;
+  /** Acknowledgements of QoS 1 messages deferred by the application */
+} mqtt_ack_t;
+
+/**
+ * @brief Initializes the deferred acknowledgements.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param ids pointer to the array used to store Packet Identifiers
+ * @param capacity number of the elements of the array, e.g. Receive Maximum announced in CONNECT
+ */
+void     __ATTR mqtt_ack_init(mqtt_ack_t *ack, uint16_t *ids, size_t capacity);
+/**
+ * @brief Defers PUBACK of the message until it is acknowledged by mqtt_ack_flush(). Shall be called inside publish callback.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param pkt pointer to PUBLISH packet structure
+ *
+ * @returns MQTT_SUCCESS if PUBACK was deferred, otherwise:
+ *          MQTT_NOT_SUPPORTED if the message is not QoS 1 or
+ *          MQTT_OUT_OF_MEM if the maximum number of the deferred messages was reached.
+ *          In both cases the message is acknowledged by process() as usual.
+ *
+ * @note Redelivered message which is already deferred is deferred once.
+ */
+uint16_t __ATTR mqtt_ack_defer(mqtt_ack_t *ack, const mqtt_publish_t *pkt);
+/**
+ * @brief Removes PUBACK packets of the deferred messages from the data prepared by process().
+ *        Shall be called each time process() returned, before the data is sent.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param data pointer to the data prepared by process()
+ */
+void     __ATTR mqtt_ack_strip(const mqtt_ack_t *ack, clv_t *data);
+/**
+ * @brief Appends PUBACK packets of the specified deferred messages to the output, so they are sent at once.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param ids pointer to Packet Identifiers of the messages to acknowledge
+ * @param count number of Packet Identifiers
+ * @param output pointer to the buffer, PUBACK packets are appended after its length
+ *
+ * @returns MQTT_SUCCESS if the packets were appended, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided or
+ *          MQTT_OUT_OF_MEM if the packets do not fit into the output, nothing is appended in this case.
+ *
+ * @note Packet Identifiers which are not deferred are skipped, e.g. after the session was not resumed.
+ * @note Shall be called outside of the callbacks, otherwise the deferred PUBACK could be sent twice.
+ */
+uint16_t __ATTR mqtt_ack_flush(mqtt_ack_t *ack, const uint16_t *ids, size_t count, clv_t *output);
+/**
+ * @brief Drops the deferred messages unless the session was resumed. Shall be called inside connack callback.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param pkt pointer to CONNACK packet structure
+ *
+ * @note If the session was resumed, the broker redelivers the deferred messages and they stay deferred.
+ */
+void     __ATTR mqtt_ack_connack(mqtt_ack_t *ack, const mqtt_connack_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_ACK_H__
@@ -0,0 +1,233 @@
+#ifndef __MQTT_CBOR_H__
+#define __MQTT_CBOR_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Unsigned integer, the value is stored in value */
+#define MQTT_CBOR_UNSIGNED    0
+/** Negative integer, the integer is -1 - value */
+#define MQTT_CBOR_NEGATIVE    1
+/** Byte string, the bytes are pointed by data */
+#define MQTT_CBOR_BYTES       2
+/** Text string, the UTF-8 characters are pointed by data */
+#define MQTT_CBOR_TEXT        3
+/** Array, the number of the items is stored in value */
+#define MQTT_CBOR_ARRAY       4
+/** Map, the number of the pairs is stored in value */
+#define MQTT_CBOR_MAP         5
+/** Tag, the tag number is stored in value and the tagged item follows */
+#define MQTT_CBOR_TAG         6
+/** Simple value (false, true, null, undefined), the value is stored in value */
+#define MQTT_CBOR_SIMPLE      7
+/** Floating point number, half, single or double precision, stored in number */
+#define MQTT_CBOR_FLOAT       8
+
+/** Simple value false */
+#define MQTT_CBOR_FALSE       20
+/** Simple value true */
+#define MQTT_CBOR_TRUE        21
+/** Simple value null */
+#define MQTT_CBOR_NULL        22
+
+/** Maximum number of the fields of the fixed-shape record */
+#define MQTT_CBOR_MAX_FIELDS  16
+/** Content Type set by mqtt_cbor_properties() */
+#define MQTT_CBOR_CONTENT_TYPE "application/cbor"
+
+typedef struct {
+  /** Encoded item type, one of MQTT_CBOR_* */
+  uint8_t type;
+  /** Integer value, number of the items or pairs, tag number or simple value */
+  uint64_t value;
+  /** Floating point number */
+  double number;
+  /** Byte or text string, points to the decoded buffer */
+  lv_t data;
+  /** Single decoded item */
+} mqtt_cbor_item_t;
+
+typedef struct {
+  /** Encoded data */
+  const uint8_t *value;
+  /** Length of the encoded data */
+  size_t length;
+  /** Offset of the next item */
+  size_t offset;
+  /** Streaming decoder */
+} mqtt_cbor_reader_t;
+
+typedef struct {
+  /** Encoded map with all keys and the placeholders of the values */
+  uint8_t *value;
+  /** Length of the encoded map */
+  size_t length;
+  /** Number of the fields */
+  uint8_t count;
+  /** Offsets of the single precision values within the encoded map */
+  uint16_t offsets[MQTT_CBOR_MAX_FIELDS];
+  /** Fixed-shape numeric record, i.e. map of text keys and single precision values */
+} mqtt_cbor_record_t;
+
+/**
+ * @brief Appends an unsigned integer.
+ *
+ * @param out pointer to the output buffer, the length is increased by the number of written bytes
+ * @param value value to encode
+ *
+ * @returns MQTT_SUCCESS if the item was written, otherwise MQTT_OUT_OF_MEM (nothing is written)
+ */
+uint16_t __ATTR mqtt_cbor_put_uint(clv_t *out, uint64_t value);
+/**
+ * @brief Appends a signed integer.
+ *
+ * @param out pointer to the output buffer
+ * @param value value to encode
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_int(clv_t *out, int64_t value);
+/**
+ * @brief Appends a byte string.
+ *
+ * @param out pointer to the output buffer
+ * @param buf pointer to the bytes
+ * @param len number of the bytes
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_bytes(clv_t *out, const uint8_t *buf, size_t len);
+/**
+ * @brief Appends a text string, the characters shall be encoded in UTF-8.
+ *
+ * @param out pointer to the output buffer
+ * @param buf pointer to the characters
+ * @param len number of the bytes
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_text(clv_t *out, const char *buf, size_t len);
+/**
+ * @brief Appends an array header, the specified number of items shall follow.
+ *
+ * @param out pointer to the output buffer
+ * @param count number of the items
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_array(clv_t *out, size_t count);
+/**
+ * @brief Appends a map header, the specified number of key and value pairs shall follow.
+ *
+ * @param out pointer to the output buffer
+ * @param count number of the pairs
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_map(clv_t *out, size_t count);
+/**
+ * @brief Appends a tag, the tagged item shall follow.
+ *
+ * @param out pointer to the output buffer
+ * @param tag tag number
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_tag(clv_t *out, uint64_t tag);
+/**
+ * @brief Appends a simple value, e.g. MQTT_CBOR_FALSE, MQTT_CBOR_TRUE or MQTT_CBOR_NULL.
+ *
+ * @param out pointer to the output buffer
+ * @param value simple value, 0 - 23 or 32 - 255
+ *
+ * @returns the same values as mqtt_cbor_put_uint(), MQTT_INVALID_ARGS if the simple value is reserved
+ */
+uint16_t __ATTR mqtt_cbor_put_simple(clv_t *out, uint8_t value);
+/**
+ * @brief Appends a single precision floating point number.
+ *
+ * @param out pointer to the output buffer
+ * @param value value to encode
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_float(clv_t *out, float value);
+/**
+ * @brief Appends a double precision floating point number.
+ *
+ * @param out pointer to the output buffer
+ * @param value value to encode
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_put_double(clv_t *out, double value);
+/**
+ * @brief Prepares the fixed-shape record: map of the text keys and single precision values.
+ *
+ * @param record pointer to the record
+ * @param buf pointer to the buffer storing the encoded map
+ * @param capacity capacity of the buffer
+ * @param keys pointer to the array of the keys
+ * @param count number of the keys, at most MQTT_CBOR_MAX_FIELDS
+ *
+ * @returns MQTT_SUCCESS if the record was prepared, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided or
+ *          MQTT_OUT_OF_MEM if the encoded map does not fit into the buffer.
+ */
+uint16_t __ATTR mqtt_cbor_record_init(mqtt_cbor_record_t *record, uint8_t *buf, size_t capacity, const lv_t *keys, uint8_t count);
+/**
+ * @brief Appends the record with the specified values. The keys are copied as prepared, only the values are encoded.
+ *
+ * @param record pointer to the record
+ * @param out pointer to the output buffer
+ * @param values pointer to the array of the values, one per key
+ *
+ * @returns the same values as mqtt_cbor_put_uint()
+ */
+uint16_t __ATTR mqtt_cbor_record_put(const mqtt_cbor_record_t *record, clv_t *out, const float *values);
+/**
+ * @brief Sets Payload Format Indicator (unspecified bytes) and Content Type (application/cbor) in PUBLISH properties.
+ *
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, properties are replaced
+ * @param buf pointer to the buffer used to store the new properties, the current properties are appended
+ * @param capacity capacity of the buffer, it shall fit the new and all current properties
+ *
+ * @returns MQTT_SUCCESS if the properties were set, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided or the current properties are malformed or not allowed in PUBLISH packet or
+ *          MQTT_OUT_OF_MEM if the properties do not fit into the buffer.
+ *
+ * @note Properties are used by MQTT 5 only, the call could be skipped for MQTT 3.1.1.
+ * @note Payload Format Indicator and Content Type found in the current properties are replaced, because including them twice is a Protocol Error.
+ *       The call could be repeated for the same parameters.
+ */
+uint16_t __ATTR mqtt_cbor_properties(mqtt_publish_params_t *params, uint8_t *buf, size_t capacity);
+/**
+ * @brief Initializes the decoder.
+ *
+ * @param reader pointer to the decoder
+ * @param buf pointer to the encoded data, e.g. the message of PUBLISH packet
+ * @param len length of the encoded data
+ */
+void     __ATTR mqtt_cbor_reader_init(mqtt_cbor_reader_t *reader, const uint8_t *buf, size_t len);
+/**
+ * @brief Decodes the next item. Items of arrays and maps are returned one by one following their header.
+ *
+ * @param reader pointer to the decoder
+ * @param item pointer to the decoded item
+ *
+ * @returns MQTT_SUCCESS if the item was decoded, otherwise:
+ *          MQTT_INVALID_STATE if there are no more items or
+ *          MQTT_MALFORMED_PACKET if the data is truncated or uses indefinite lengths (not supported).
+ */
+uint16_t __ATTR mqtt_cbor_read(mqtt_cbor_reader_t *reader, mqtt_cbor_item_t *item);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_CBOR_H__
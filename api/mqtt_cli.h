@@ -144,6 +144,11 @@ struct mqtt_cli {
      * 
      * @note This setting is optional.
      * @note Default value is 60s.
+     * @note PINGREQ is sent only if no other packet was prepared to send within the Keep Alive period,
+     *       i.e. any PUBLISH, SUBSCRIBE, UNSUBSCRIBE or PUBACK (also prepared by the *_ex functions) postpones it.
+     * @note Received packets do not postpone PINGREQ. If PINGRESP is not received, the next PINGREQ is still sent
+     *       when it is due and DISCONNECT is prepared one process() timeout later, e.g. with Keep Alive 3
+     *       and 1 second timeout PINGREQ is sent at 3rd and 6th second and DISCONNECT at 7th second.
      */
     void     (*set_br_keepalive) (const mqtt_cli_t *self, const uint16_t keep_alive);
     /**
@@ -0,0 +1,95 @@
+#ifndef __MQTT_CLIENT_H__
+#define __MQTT_CLIENT_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Private context data, the same as mqtt_cli_t::ctx */
+  struct mqtt_cli_ctx *ctx;
+  /** Operations shared by all clients, only function pointers of the table are used */
+  const mqtt_cli_t *ops;
+  /** User data specified during initialization */
+  void *user_data;
+  /** Compact mqtt client, the function pointers are not stored per client */
+} mqtt_client_t;
+
+/**
+ * @brief Initializes MQTT protocol with specified parameters, see mqtt_cli_init_ex().
+ *
+ * @param client pointer to the client
+ * @param params pointer protocol parameters, NULL to use default parameters
+ * @param user_data user data returned by mqtt_client_user_data() inside the callbacks of this client
+ *
+ * @returns MQTT_SUCCESS if the library was successfully initialized, otherwise:
+ *          MQTT_OUT_OF_MEM if there was not enough memory to initialize the library or
+ *          MQTT_INVALID_ARGS if specified parameters are out of acceptable ranges.
+ */
+uint16_t __ATTR mqtt_client_init(mqtt_client_t *client, mqtt_params_t *params, void *user_data);
+/**
+ * @brief Releases the library's resources, see mqtt_cli_destr().
+ *
+ * @param client pointer to the client
+ */
+void     __ATTR mqtt_client_destr(mqtt_client_t *client);
+/**
+ * @brief Obtains the operations shared by all clients.
+ *
+ * @returns pointer to the operations or NULL if no client was initialized yet
+ */
+const mqtt_cli_t* __ATTR mqtt_client_ops(void);
+/**
+ * @brief Obtains user data of the client being processed. Shall be called inside the callbacks.
+ *
+ * @returns user data specified during initialization of the client whose mqtt_client_process() is executed,
+ *          NULL outside of mqtt_client_process()
+ *
+ * @note The callbacks receive the library's context only, so the client being processed is tracked by mqtt_client_process().
+ *       The library shall not be called by several threads at once anyway, because it keeps the packet structures in static variables.
+ */
+void*    __ATTR mqtt_client_user_data(void);
+
+/* The functions below call the operation of the same name of mqtt_cli_t, see its description */
+
+uint16_t __ATTR mqtt_client_publish(const mqtt_client_t *client, const mqtt_publish_params_t *params);
+uint16_t __ATTR mqtt_client_publish_ex(const mqtt_client_t *client, const mqtt_publish_params_t *params, clv_t *output);
+uint16_t __ATTR mqtt_client_subscribe(const mqtt_client_t *client, const mqtt_subscribe_params_t *params);
+uint16_t __ATTR mqtt_client_subscribe_ex(const mqtt_client_t *client, const mqtt_subscribe_params_t *params, clv_t *output);
+uint16_t __ATTR mqtt_client_unsubscribe(const mqtt_client_t *client, const mqtt_unsubscribe_params_t *params);
+uint16_t __ATTR mqtt_client_unsubscribe_ex(const mqtt_client_t *client, const mqtt_unsubscribe_params_t *params, clv_t *output);
+uint16_t __ATTR mqtt_client_process(const mqtt_client_t *client, clv_t *data, mqtt_channel_t *channel);
+void     __ATTR mqtt_client_disconnect(const mqtt_client_t *client);
+void     __ATTR mqtt_client_set_br_keepalive(const mqtt_client_t *client, const uint16_t keep_alive);
+void     __ATTR mqtt_client_get_br_keepalive(const mqtt_client_t *client, uint16_t *keep_alive);
+void     __ATTR mqtt_client_set_br_ip(const mqtt_client_t *client, const uint32_t ip);
+void     __ATTR mqtt_client_get_br_ip(const mqtt_client_t *client, uint32_t *ip);
+uint16_t __ATTR mqtt_client_set_br_userid(const mqtt_client_t *client, const lv_t *user_id);
+void     __ATTR mqtt_client_get_br_userid(const mqtt_client_t *client, lv_t *user_id);
+uint16_t __ATTR mqtt_client_set_br_username(const mqtt_client_t *client, const lv_t *user_name);
+void     __ATTR mqtt_client_get_br_username(const mqtt_client_t *client, lv_t *user_name);
+uint16_t __ATTR mqtt_client_set_br_password(const mqtt_client_t *client, const lv_t *password);
+void     __ATTR mqtt_client_get_br_password(const mqtt_client_t *client, lv_t *password);
+uint16_t __ATTR mqtt_client_set_br_will(const mqtt_client_t *client, const mqtt_will_params_t *will);
+void     __ATTR mqtt_client_get_br_will(const mqtt_client_t *client, mqtt_will_params_t *will);
+void     __ATTR mqtt_client_is_connected(const mqtt_client_t *client, uint8_t *is_connected);
+void     __ATTR mqtt_client_get_pkt_length(const mqtt_client_t *client, lv_t *packet, size_t *length);
+void     __ATTR mqtt_client_get_lib_version(const mqtt_client_t *client, uint32_t *version);
+void     __ATTR mqtt_client_get_last_pkt(const mqtt_client_t *client, uint8_t *last_pkt);
+void     __ATTR mqtt_client_get_buffersize(const mqtt_client_t *client, uint16_t *buffersize);
+void     __ATTR mqtt_client_set_cb_disconnect(const mqtt_client_t *client, cb_mqtt_disconnect_t cb_mqtt_disconnect);
+void     __ATTR mqtt_client_set_cb_puback(const mqtt_client_t *client, cb_mqtt_puback_t cb_mqtt_puback);
+void     __ATTR mqtt_client_set_cb_publish(const mqtt_client_t *client, cb_mqtt_publish_t cb_mqtt_publish);
+void     __ATTR mqtt_client_set_cb_suback(const mqtt_client_t *client, cb_mqtt_suback_t cb_mqtt_suback);
+void     __ATTR mqtt_client_set_cb_connack(const mqtt_client_t *client, cb_mqtt_connack_t cb_mqtt_connack);
+void     __ATTR mqtt_client_set_cb_auth(const mqtt_client_t *client, cb_mqtt_auth_t cb_mqtt_auth);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_CLIENT_H__
@@ -0,0 +1,65 @@
+#ifndef __MQTT_DEDUP_H__
+#define __MQTT_DEDUP_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Size of the bitmap in bytes, one bit per Packet Identifier */
+#define MQTT_DEDUP_SIZE   (65536 / 8)
+
+typedef struct {
+  /** Bit set for each Packet Identifier of QoS 1 PUBLISH delivered during the current connection */
+  uint8_t current[MQTT_DEDUP_SIZE];
+  /** Bit set for each Packet Identifier delivered during the previous connection, PUBACK could be lost when it was closed */
+  uint8_t previous[MQTT_DEDUP_SIZE];
+  /** Number of the suppressed duplicates */
+  size_t suppressed;
+  /** Inbound QoS 1 duplicate filter, both bitmaps could be stored with the session */
+} mqtt_dedup_t;
+
+/**
+ * @brief Initializes the filter, no Packet Identifier is marked as delivered.
+ *
+ * @param dedup pointer to the filter
+ */
+void     __ATTR mqtt_dedup_init(mqtt_dedup_t *dedup);
+/**
+ * @brief Starts the next connection of the filter. Shall be called inside connack callback.
+ *
+ * @param dedup pointer to the filter
+ * @param pkt pointer to CONNACK packet structure
+ *
+ * @note If the session was resumed, the marks of the current connection become the marks of the previous one and the older
+ *       marks are dropped, otherwise all marks are cleared as the broker redelivers the messages of the resumed session only.
+ */
+void     __ATTR mqtt_dedup_connack(mqtt_dedup_t *dedup, const mqtt_connack_t *pkt);
+/**
+ * @brief Checks if the message was already delivered. Shall be called inside publish callback before the message is used.
+ *
+ * @param dedup pointer to the filter
+ * @param pkt pointer to PUBLISH packet structure
+ *
+ * @returns 1 if the message is a duplicate: the callback shall return RC_SUCCESS without using it, so it is acknowledged again,
+ *          otherwise 0 and the Packet Identifier is marked as delivered.
+ *
+ * @note Only QoS 1 messages are checked, QoS 0 has no Packet Identifier and QoS 2 is delivered once by the protocol itself.
+ * @note PUBLISH without DUP flag is always a new message, the broker reuses the Packet Identifier once PUBACK was received,
+ *       so it also drops the mark left by the previous connection. Redelivery (DUP flag set) is reported as a duplicate
+ *       if the Packet Identifier was marked during the current or the previous connection.
+ * @warning A message is still lost if the broker reused the Packet Identifier delivered earlier in the previous connection
+ *          and that PUBLISH was lost when the connection was closed: its redelivery cannot be told apart from a duplicate.
+ *          Marks older than the previous connection are dropped, so a redelivery delayed by more than one reconnection
+ *          is delivered again instead, which is allowed by QoS 1.
+ */
+uint8_t  __ATTR mqtt_dedup_check(mqtt_dedup_t *dedup, const mqtt_publish_t *pkt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_DEDUP_H__
@@ -0,0 +1,131 @@
+#ifndef __MQTT_GROUP_H__
+#define __MQTT_GROUP_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of the group members */
+#define MQTT_GROUP_MAX_MEMBERS  256
+/** Maximum length of the Share Name */
+#define MQTT_GROUP_MAX_NAME_LEN 32
+
+typedef struct mqtt_group mqtt_group_t;
+
+/**
+ * @brief Callback definition for the message received by the group member.
+ * @param arg user argument specified in the group parameters
+ * @param member index of the member which received the message
+ * @param pkt pointer to PUBLISH packet structure
+ *
+ * @note The callback is called by the worker thread of the member without the library lock, the message is copied
+ *       once parsed and QoS 1 message is already acknowledged. The packet structure is valid during the call only.
+ *       A slow callback delays the other members of the same worker thread, each member gets a time slice per turn.
+ */
+typedef void (*cb_mqtt_group_t) (void *arg, size_t member, const mqtt_publish_t *pkt);
+
+typedef struct {
+  /** Number of received messages */
+  uint64_t messages;
+  /** Number of received payload bytes */
+  uint64_t bytes;
+  /** Number of received bytes not passed to the callback yet, including the data waiting in the socket */
+  size_t backlog;
+  /** Number of received bytes the member left for its next turn, i.e. not passed to the callback within its time slice */
+  size_t lag;
+  /** Set to 1 once CONNACK is received */
+  uint8_t connected;
+  /** Set to 1 once SUBACK is received */
+  uint8_t subscribed;
+  /** Set to 1 while the member is unsubscribed because of its lag */
+  uint8_t paused;
+  /** Number of times the member was paused */
+  uint64_t pauses;
+  /** Statistics of the single group member */
+} mqtt_group_stats_t;
+
+typedef struct {
+  /** Broker's IPv4 address in network byte order */
+  uint32_t ip;
+  /** Broker's port in host byte order */
+  uint16_t port;
+  /** Share Name, the value is copied */
+  lv_t share_name;
+  /** Topic Filter, the value is copied */
+  lv_t filter;
+  /** Maximum QoS of the subscription, up to MAX_QOS */
+  uint8_t qos;
+  /** Client Identifier prefix, the member index is appended, the library requires at least 8 characters in total */
+  lv_t userid;
+  /** Number of the members, i.e. clients and connections */
+  size_t members;
+  /** Number of the worker threads, members are spread evenly across them */
+  size_t threads;
+  /** Size of the receive and send buffers of each member */
+  size_t sockbuf;
+  /** Lag in bytes above which the member unsubscribes, so the broker delivers new messages to the others, 0 disables rebalancing */
+  size_t pause_backlog;
+  /** Lag in bytes at or below which the paused member subscribes again */
+  size_t resume_backlog;
+  /** Parameters passed to mqtt_cli_init_ex() for each member */
+  mqtt_params_t params;
+  /** Message callback, could be NULL */
+  cb_mqtt_group_t cb;
+  /** User argument passed to the callback */
+  void *arg;
+  /** Parameters of the shared subscription group */
+} mqtt_group_params_t;
+
+/**
+ * @brief Connects all members, subscribes them to $share/{share_name}/{filter} and starts the worker threads.
+ *
+ * @param group pointer to the created group
+ * @param params pointer to the group parameters
+ *
+ * @returns MQTT_SUCCESS if the group was started, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided,
+ *          MQTT_OUT_OF_MEM if there was not enough memory,
+ *          MQTT_NOT_CONNECTED if any member could not connect to the broker or
+ *          the value returned by mqtt_cli_init_ex() or set_br_userid().
+ *
+ * @note The prebuilt library keeps the packet structures used by process() in static variables shared by all clients,
+ *       so the worker threads parse the packets one at a time while holding the library lock, the callback is called
+ *       after the lock is released.
+ * @note If pause_backlog is set, the member whose lag exceeds it unsubscribes until the lag drops to resume_backlog,
+ *       the broker shares the new messages among the other members meanwhile. At least one member stays subscribed.
+ *       Both are checked after every turn of the member.
+ */
+uint16_t __ATTR mqtt_group_start(mqtt_group_t **group, const mqtt_group_params_t *params);
+/**
+ * @brief Copies the statistics of all members.
+ *
+ * @param group pointer to the group
+ * @param stats pointer to the array of statistics with one entry per member
+ *
+ * @returns number of the members which are still connected
+ */
+size_t   __ATTR mqtt_group_stats(mqtt_group_t *group, mqtt_group_stats_t *stats);
+/**
+ * @brief Stops the worker threads, disconnects all members and releases the group.
+ *
+ * @param group pointer to the group
+ */
+void     __ATTR mqtt_group_stop(mqtt_group_t *group);
+/**
+ * @brief Acquires the library lock, shall be held while any other client of the application calls the library.
+ */
+void     __ATTR mqtt_group_lock(void);
+/**
+ * @brief Releases the library lock.
+ */
+void     __ATTR mqtt_group_unlock(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_GROUP_H__
@@ -0,0 +1,121 @@
+#ifndef __MQTT_JSON_H__
+#define __MQTT_JSON_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum nesting of objects and arrays */
+#define MQTT_JSON_MAX_DEPTH   16
+
+typedef struct {
+  /** Output buffer, the length is increased by the written bytes */
+  clv_t *out;
+  /** Output length before the document */
+  size_t start;
+  /** Current nesting level */
+  uint8_t depth;
+  /** Bit set for each level which already contains a member, i.e. the next one is preceded by a comma */
+  uint16_t members;
+  /** Bit set for each level which is an array, otherwise it is an object */
+  uint16_t arrays;
+  /** Set to 1 if the key was written and its value is expected */
+  uint8_t key;
+  /** First error, MQTT_SUCCESS if none */
+  uint16_t rc;
+  /** Streaming JSON writer */
+} mqtt_json_t;
+
+/**
+ * @brief Initializes the writer.
+ *
+ * @param json pointer to the writer
+ * @param out pointer to the output buffer, the data is appended to its current length
+ *
+ * @note Errors are sticky: once the output is full, the following calls write nothing and mqtt_json_end() reports the error,
+ *       so the values could be written without checking each call.
+ */
+void     __ATTR mqtt_json_init(mqtt_json_t *json, clv_t *out);
+/**
+ * @brief Begins an object.
+ *
+ * @param json pointer to the writer
+ */
+void     __ATTR mqtt_json_object(mqtt_json_t *json);
+/**
+ * @brief Begins an array.
+ *
+ * @param json pointer to the writer
+ */
+void     __ATTR mqtt_json_array(mqtt_json_t *json);
+/**
+ * @brief Ends the current object or array.
+ *
+ * @param json pointer to the writer
+ */
+void     __ATTR mqtt_json_close(mqtt_json_t *json);
+/**
+ * @brief Writes the key of the object member, the value shall follow.
+ *
+ * @param json pointer to the writer
+ * @param key key terminated with '\0', written without escaping
+ */
+void     __ATTR mqtt_json_key(mqtt_json_t *json, const char *key);
+/**
+ * @brief Writes the string value, the characters are escaped.
+ *
+ * @param json pointer to the writer
+ * @param value pointer to the UTF-8 characters
+ * @param len number of the bytes
+ */
+void     __ATTR mqtt_json_string(mqtt_json_t *json, const char *value, size_t len);
+/**
+ * @brief Writes the string value made of the concatenated parts, e.g. "~/" and a topic.
+ *
+ * @param json pointer to the writer
+ * @param parts pointer to the array of the parts
+ * @param count number of the parts
+ */
+void     __ATTR mqtt_json_string_ex(mqtt_json_t *json, const lv_t *parts, size_t count);
+/**
+ * @brief Writes the integer value.
+ *
+ * @param json pointer to the writer
+ * @param value value to write
+ */
+void     __ATTR mqtt_json_int(mqtt_json_t *json, int32_t value);
+/**
+ * @brief Writes true or false.
+ *
+ * @param json pointer to the writer
+ * @param value value to write
+ */
+void     __ATTR mqtt_json_bool(mqtt_json_t *json, uint8_t value);
+/**
+ * @brief Writes null.
+ *
+ * @param json pointer to the writer
+ */
+void     __ATTR mqtt_json_null(mqtt_json_t *json);
+/**
+ * @brief Checks the written document.
+ *
+ * @param json pointer to the writer
+ *
+ * @returns MQTT_SUCCESS if the whole document was written, otherwise:
+ *          MQTT_OUT_OF_MEM if the document does not fit into the output buffer or
+ *          MQTT_INVALID_STATE if the objects and arrays are not balanced, a key has no value or the nesting is too deep.
+ *
+ * @note If the document was not written completely, the output length is restored to the value before mqtt_json_init().
+ */
+uint16_t __ATTR mqtt_json_end(mqtt_json_t *json);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_JSON_H__
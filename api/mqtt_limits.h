@@ -0,0 +1,64 @@
+#ifndef __MQTT_LIMITS_H__
+#define __MQTT_LIMITS_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Maximum Packet Size accepted by the broker, 0 if not limited */
+  uint32_t max_packet_size;
+  /** MQTT protocol version */
+  uint8_t version;
+  /** Limits announced by the broker in CONNACK packet */
+} mqtt_limits_t;
+
+/**
+ * @brief Initializes the limits, nothing is limited until CONNACK is received.
+ *
+ * @param limits pointer to the limits
+ * @param version MQTT protocol version used by the client
+ */
+void     __ATTR mqtt_limits_init(mqtt_limits_t *limits, uint8_t version);
+/**
+ * @brief Obtains Maximum Packet Size from CONNACK packet. Shall be called inside connack callback.
+ *
+ * @param limits pointer to the limits
+ * @param self pointer to the callback context
+ * @param pkt pointer to CONNACK packet structure
+ */
+void     __ATTR mqtt_limits_connack(mqtt_limits_t *limits, const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt);
+/**
+ * @brief Calculates size of PUBLISH packet without creating it.
+ *
+ * @param limits pointer to the limits
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet
+ *
+ * @returns number of bytes of the whole packet
+ */
+size_t   __ATTR mqtt_limits_publish_size(const mqtt_limits_t *limits, const mqtt_publish_params_t *params);
+/**
+ * @brief Checks if PUBLISH packet fits into Maximum Packet Size, User Properties are removed if needed.
+ *
+ * @param limits pointer to the limits
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, properties could be replaced
+ * @param buf pointer to the buffer used to store the properties without User Properties, could be NULL
+ * @param capacity capacity of the buffer
+ *
+ * @returns MQTT_SUCCESS if the packet fits, otherwise:
+ *          MQTT_INVALID_ARGS if the properties are malformed or
+ *          MQTT_PKT_TOO_LARGE if the packet does not fit even without User Properties.
+ *
+ * @note Shall be called before publish(), publish_ex() or publish() inside callbacks, nothing is copied if the packet fits.
+ */
+uint16_t __ATTR mqtt_limits_fit(const mqtt_limits_t *limits, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_LIMITS_H__
@@ -0,0 +1,95 @@
+#ifndef __MQTT_LVC_H__
+#define __MQTT_LVC_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Hash of the Topic Name */
+  uint32_t hash;
+  /** Length of the Topic Name */
+  uint16_t topic_len;
+  /** Length of the message */
+  uint16_t message_len;
+  /** PUBLISH flags of the message */
+  uint8_t flags;
+  /** Set to 1 when the entry is stored or read, cleared by the eviction */
+  uint8_t referenced;
+  /** Set to 1 if the slot stores the entry */
+  uint8_t used;
+  /** Single cached Topic Name and its last message */
+} mqtt_lvc_slot_t;
+
+typedef struct {
+  /** Slots of the entries */
+  mqtt_lvc_slot_t *slots;
+  /** Number of the slots */
+  size_t count;
+  /** Buffer storing Topic Name and message of each slot */
+  uint8_t *value;
+  /** Size of the buffer used by a single slot */
+  size_t slot_size;
+  /** Number of the cached entries */
+  size_t length;
+  /** Maximum number of the cached entries, a quarter of the slots is kept free to keep probing short */
+  size_t capacity;
+  /** Slot checked next by the eviction */
+  size_t hand;
+  /** Number of the evicted entries */
+  size_t evicted;
+  /** Cache of the last message received for each Topic Name */
+} mqtt_lvc_t;
+
+/**
+ * @brief Initializes the cache.
+ *
+ * @param lvc pointer to the cache
+ * @param slots pointer to the array of slots
+ * @param count number of the slots, at least 2
+ * @param buf pointer to the buffer of count * slot_size bytes
+ * @param slot_size size of the buffer used by a single slot, i.e. maximum length of Topic Name and message together
+ */
+void     __ATTR mqtt_lvc_init(mqtt_lvc_t *lvc, mqtt_lvc_slot_t *slots, size_t count, uint8_t *buf, size_t slot_size);
+/**
+ * @brief Stores the message as the last value of its Topic Name. Shall be called inside publish callback.
+ *
+ * @param lvc pointer to the cache
+ * @param pkt pointer to PUBLISH packet structure, Topic Name and message are copied
+ *
+ * @returns MQTT_SUCCESS if the message was stored, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided or
+ *          MQTT_OUT_OF_MEM if Topic Name and message do not fit into the slot.
+ *
+ * @note If the cache is full, the entry not read since the last sweep is evicted (CLOCK), so the memory used stays fixed.
+ * @note Retained message with empty payload removes the entry, as the broker does.
+ * @note If the message does not fit, the previous value is removed, so a stale value is never returned.
+ */
+uint16_t __ATTR mqtt_lvc_update(mqtt_lvc_t *lvc, const mqtt_publish_t *pkt);
+/**
+ * @brief Obtains the last message received for the Topic Name.
+ *
+ * @param lvc pointer to the cache
+ * @param topic pointer to the Topic Name
+ * @param message pointer to the message, the value points to the cache buffer and is valid until the next update
+ *
+ * @returns 1 if the message was found, otherwise 0
+ */
+uint8_t  __ATTR mqtt_lvc_get(mqtt_lvc_t *lvc, const lv_t *topic, lv_t *message);
+/**
+ * @brief Removes the entry of the Topic Name.
+ *
+ * @param lvc pointer to the cache
+ * @param topic pointer to the Topic Name
+ */
+void     __ATTR mqtt_lvc_remove(mqtt_lvc_t *lvc, const lv_t *topic);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_LVC_H__
@@ -0,0 +1,72 @@
+#ifndef __MQTT_PIPELINE_H__
+#define __MQTT_PIPELINE_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Buffer used to store the queued packets */
+  uint8_t *value;
+  /** Capacity of the buffer */
+  size_t capacity;
+  /** Length of the queued packets */
+  size_t length;
+  /** Length of the queued packets returned for sending and not committed yet */
+  size_t sent;
+  /** MQTT protocol version */
+  uint8_t version;
+  /** Packets sent right behind CONNECT without waiting for CONNACK */
+} mqtt_pipeline_t;
+
+/**
+ * @brief Initializes the pipeline.
+ *
+ * @param pipeline pointer to the pipeline
+ * @param version MQTT protocol version used by the client
+ * @param buf pointer to the buffer used to store the queued packets
+ * @param capacity capacity of the buffer
+ */
+void     __ATTR mqtt_pipeline_init(mqtt_pipeline_t *pipeline, uint8_t version, uint8_t *buf, size_t capacity);
+/**
+ * @brief Queues PUBLISH packet which will be sent right behind the next CONNECT packet.
+ *
+ * @param pipeline pointer to the pipeline
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet
+ *
+ * @returns MQTT_SUCCESS if the packet was queued, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided,
+ *          MQTT_NOT_SUPPORTED if QoS other than 0 was requested or
+ *          MQTT_OUT_OF_MEM if there is not enough space in the buffer.
+ *
+ * @note Only QoS 0 is supported, because Packet Identifiers are allocated by the client after CONNACK.
+ * @note The broker's Maximum Packet Size is not known before CONNACK, so the packets should be kept small.
+ */
+uint16_t __ATTR mqtt_pipeline_publish(mqtt_pipeline_t *pipeline, const mqtt_publish_params_t *params);
+/**
+ * @brief Obtains the queued packets if the data prepared by process() contains CONNECT packet.
+ *
+ * @param pipeline pointer to the pipeline
+ * @param data pointer to the data prepared by process()
+ * @param packets pointer to the queued packets which shall be sent right after the data, length is 0 if there is nothing to send
+ *
+ * @note The queued packets are kept until mqtt_pipeline_commit() is called, so they are sent again after the next CONNECT
+ *       if the connection was rejected or lost before CONNACK.
+ */
+void     __ATTR mqtt_pipeline_get(mqtt_pipeline_t *pipeline, const clv_t *data, lv_t *packets);
+/**
+ * @brief Releases the packets sent behind CONNECT. Shall be called when CONNACK was received, e.g. inside connack callback.
+ *
+ * @param pipeline pointer to the pipeline
+ */
+void     __ATTR mqtt_pipeline_commit(mqtt_pipeline_t *pipeline);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_PIPELINE_H__
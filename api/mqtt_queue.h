@@ -0,0 +1,137 @@
+#ifndef __MQTT_QUEUE_H__
+#define __MQTT_QUEUE_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Every message is queued */
+#define MQTT_QUEUE_FIFO         0
+/** A newer message replaces the queued message with the same Topic Name */
+#define MQTT_QUEUE_LAST_VALUE   1
+
+/** Control messages, e.g. availability */
+#define MQTT_QUEUE_LANE_CONTROL     0
+/** Interactive messages, e.g. command acknowledgements */
+#define MQTT_QUEUE_LANE_INTERACTIVE 1
+/** Bulk messages, e.g. telemetry */
+#define MQTT_QUEUE_LANE_BULK        2
+/** Number of the priority lanes */
+#define MQTT_QUEUE_LANES            3
+
+typedef struct {
+  /** Hash of the Topic Name */
+  uint32_t hash;
+  /** Sequence number of the last update, messages are taken in this order */
+  uint32_t seq;
+  /** Time when the message expires, valid if expiry_offset is not 0 */
+  uint32_t expiry;
+  /** Length of the Topic Name */
+  uint16_t topic_len;
+  /** Length of the message */
+  uint16_t message_len;
+  /** Length of the properties */
+  uint8_t properties_len;
+  /** Offset of the Message Expiry Interval value within the properties increased by 1, 0 if not present */
+  uint8_t expiry_offset;
+  /** PUBLISH flags */
+  uint8_t flags;
+  /** Priority lane, lower lanes are taken first */
+  uint8_t lane;
+  /** Slot state */
+  uint8_t state;
+  /** Single queued message */
+} mqtt_queue_slot_t;
+
+typedef struct {
+  /** Slots of the queued messages */
+  mqtt_queue_slot_t *slots;
+  /** Number of the slots */
+  size_t count;
+  /** Buffer storing Topic Name, properties and message of each slot */
+  uint8_t *value;
+  /** Size of the buffer used by a single slot */
+  size_t slot_size;
+  /** Number of the queued messages */
+  size_t length;
+  /** Last used sequence number */
+  uint32_t seq;
+  /** Slot returned by mqtt_queue_peek() */
+  size_t front;
+  /** Number of the messages dropped because Message Expiry Interval elapsed */
+  size_t expired;
+  /** Queue mode, MQTT_QUEUE_FIFO or MQTT_QUEUE_LAST_VALUE */
+  uint8_t mode;
+  /** Queue of PUBLISH packets kept while the client is not connected */
+} mqtt_queue_t;
+
+/**
+ * @brief Initializes the queue.
+ *
+ * @param queue pointer to the queue
+ * @param mode MQTT_QUEUE_FIFO or MQTT_QUEUE_LAST_VALUE
+ * @param slots pointer to the array of slots
+ * @param count number of the slots
+ * @param buf pointer to the buffer of count * slot_size bytes
+ * @param slot_size size of the buffer used by a single slot
+ */
+void     __ATTR mqtt_queue_init(mqtt_queue_t *queue, uint8_t mode, mqtt_queue_slot_t *slots, size_t count, uint8_t *buf, size_t slot_size);
+/**
+ * @brief Queues the message. In MQTT_QUEUE_LAST_VALUE mode the message queued for the same Topic Name is replaced in place.
+ *
+ * @param queue pointer to the queue
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, all values are copied
+ * @param now current time in seconds, e.g. monotonic clock
+ *
+ * @returns MQTT_SUCCESS if the message was queued, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments or malformed properties were provided or
+ *          MQTT_OUT_OF_MEM if there is no free slot or the message does not fit into the slot.
+ *
+ * @note Slots are found by the hash of the Topic Name, so the memory used is bounded by the number of distinct topics.
+ * @note If the properties contain Message Expiry Interval, the message expires after this number of seconds.
+ * @note The message is queued in MQTT_QUEUE_LANE_BULK lane.
+ */
+uint16_t __ATTR mqtt_queue_push(mqtt_queue_t *queue, const mqtt_publish_params_t *params, uint32_t now);
+/**
+ * @brief Queues the message in the specified priority lane.
+ *
+ * @param queue pointer to the queue
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, all values are copied
+ * @param lane priority lane, one of MQTT_QUEUE_LANE_*
+ * @param now current time in seconds, e.g. monotonic clock
+ *
+ * @returns the same values as mqtt_queue_push()
+ *
+ * @note In MQTT_QUEUE_LAST_VALUE mode the replaced message is moved to the specified lane.
+ */
+uint16_t __ATTR mqtt_queue_push_ex(mqtt_queue_t *queue, const mqtt_publish_params_t *params, uint8_t lane, uint32_t now);
+/**
+ * @brief Obtains the oldest queued message of the highest priority lane without removing it. Expired messages are dropped and counted.
+ *
+ * @param queue pointer to the queue
+ * @param params pointer to the structure receiving the message, values point to the queue buffer
+ * @param now current time in seconds, the same clock as used by mqtt_queue_push()
+ *
+ * @returns 1 if the message was obtained, 0 if the queue is empty
+ *
+ * @note Message Expiry Interval of the obtained message is set to the remaining number of seconds.
+ * @note Lanes are drained in strict priority order. Acknowledgements are prepared by process() itself,
+ *       so draining the queue after process() returned never delays them.
+ */
+uint8_t  __ATTR mqtt_queue_peek(mqtt_queue_t *queue, mqtt_publish_params_t *params, uint32_t now);
+/**
+ * @brief Removes the message obtained by mqtt_queue_peek(), e.g. after it was published.
+ *
+ * @param queue pointer to the queue
+ */
+void     __ATTR mqtt_queue_pop(mqtt_queue_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_QUEUE_H__
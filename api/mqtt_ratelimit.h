@@ -0,0 +1,73 @@
+#ifndef __MQTT_RATELIMIT_H__
+#define __MQTT_RATELIMIT_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Messages per second, 0 if not limited */
+  uint32_t msg_rate;
+  /** Maximum number of messages sent at once */
+  uint32_t msg_burst;
+  /** Bytes per second, 0 if not limited */
+  uint32_t byte_rate;
+  /** Maximum number of bytes sent at once */
+  uint32_t byte_burst;
+  /** Available messages multiplied by 1000 */
+  uint64_t msg_tokens;
+  /** Available bytes multiplied by 1000 */
+  uint64_t byte_tokens;
+  /** Time of the last refill in milliseconds */
+  uint32_t last;
+  /** Token bucket rate limiter */
+} mqtt_ratelimit_t;
+
+/**
+ * @brief Initializes the rate limiter, both buckets are full.
+ *
+ * @param limit pointer to the rate limiter
+ * @param msg_rate messages per second, 0 if not limited
+ * @param msg_burst maximum number of messages sent at once
+ * @param byte_rate bytes per second, 0 if not limited
+ * @param byte_burst maximum number of bytes sent at once
+ * @param now current time in milliseconds, e.g. monotonic clock
+ */
+void     __ATTR mqtt_ratelimit_init(mqtt_ratelimit_t *limit, uint32_t msg_rate, uint32_t msg_burst, uint32_t byte_rate, uint32_t byte_burst, uint32_t now);
+/**
+ * @brief Takes tokens for a single message.
+ *
+ * @param limit pointer to the rate limiter
+ * @param bytes number of bytes of the message
+ * @param now current time in milliseconds
+ * @param wait pointer to the number of milliseconds until enough tokens are available, could be NULL
+ *
+ * @returns MQTT_SUCCESS if tokens were taken, otherwise:
+ *          MQTT_INVALID_ARGS if the message is larger than the byte burst or
+ *          MQTT_THROTTLED if there are not enough tokens.
+ */
+uint16_t __ATTR mqtt_ratelimit_take(mqtt_ratelimit_t *limit, size_t bytes, uint32_t now, uint32_t *wait);
+/**
+ * @brief Prepares PUBLISH packet if the rate limit allows it.
+ *
+ * @param limit pointer to the rate limiter
+ * @param cli pointer to the client
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet
+ * @param now current time in milliseconds
+ * @param wait pointer to the number of milliseconds until the message could be published, could be NULL
+ *
+ * @returns MQTT_THROTTLED if the rate limit was reached, otherwise the same values as mqtt_ratelimit_take() and publish().
+ *
+ * @note Bytes are counted as Topic Name, properties and message lengths. Tokens are not taken if publish() failed.
+ */
+uint16_t __ATTR mqtt_ratelimit_publish(mqtt_ratelimit_t *limit, const mqtt_cli_t *cli, const mqtt_publish_params_t *params, uint32_t now, uint32_t *wait);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_RATELIMIT_H__
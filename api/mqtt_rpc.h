@@ -0,0 +1,140 @@
+#ifndef __MQTT_RPC_H__
+#define __MQTT_RPC_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Length of the Correlation Data used by the requests */
+#define MQTT_RPC_TOKEN_LEN    8
+
+/**
+ * @brief Callback definition for the request completion.
+ * @param arg user argument specified with the request
+ * @param pkt pointer to the response PUBLISH packet structure, NULL if the request timed out
+ */
+typedef void (*cb_mqtt_rpc_t) (void *arg, const mqtt_publish_t *pkt);
+
+typedef struct {
+  /** Completion callback, NULL if the slot is free */
+  cb_mqtt_rpc_t cb;
+  /** User argument */
+  void *arg;
+  /** Generation of the slot, changed each time the slot is released */
+  uint32_t generation;
+  /** Time when the request times out */
+  uint32_t deadline;
+  /** Previous pending request */
+  uint32_t prev;
+  /** Next pending request or next free slot */
+  uint32_t next;
+  /** Single pending request */
+} mqtt_rpc_slot_t;
+
+typedef struct {
+  /** Slots of the requests */
+  mqtt_rpc_slot_t *slots;
+  /** Number of the slots */
+  uint32_t count;
+  /** First free slot */
+  uint32_t free;
+  /** Oldest pending request */
+  uint32_t head;
+  /** Newest pending request */
+  uint32_t tail;
+  /** Number of the pending requests */
+  uint32_t pending;
+  /** Request timeout in seconds */
+  uint32_t timeout;
+  /** Number of the requests which timed out */
+  size_t expired;
+  /** Response Topic, the value is not copied */
+  lv_t response_topic;
+  /** Request/response correlation table */
+} mqtt_rpc_t;
+
+/**
+ * @brief Initializes the correlation table.
+ *
+ * @param rpc pointer to the correlation table
+ * @param slots pointer to the array of slots
+ * @param count number of the slots, i.e. maximum number of pending requests
+ * @param response_topic pointer to the Response Topic the client is subscribed to, the value is not copied
+ * @param timeout request timeout in seconds
+ */
+void     __ATTR mqtt_rpc_init(mqtt_rpc_t *rpc, mqtt_rpc_slot_t *slots, uint32_t count, const lv_t *response_topic, uint32_t timeout);
+/**
+ * @brief Allocates the request and adds Response Topic and Correlation Data to the PUBLISH properties.
+ *
+ * @param rpc pointer to the correlation table
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, properties are replaced
+ * @param buf pointer to the buffer used to store the new properties
+ * @param capacity capacity of the buffer
+ * @param cb completion callback
+ * @param arg user argument passed to the callback
+ * @param now current time in seconds
+ * @param slot pointer to the allocated slot, could be NULL
+ *
+ * @returns MQTT_SUCCESS if the request was allocated, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided,
+ *          MQTT_OUT_OF_MEM if the properties do not fit into the buffer or
+ *          MQTT_NO_PKT_ID if there is no free slot.
+ *
+ * @note If the packet could not be published, the request shall be released with mqtt_rpc_cancel().
+ */
+uint16_t __ATTR mqtt_rpc_prepare(mqtt_rpc_t *rpc, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity, cb_mqtt_rpc_t cb, void *arg, uint32_t now, uint32_t *slot);
+/**
+ * @brief Releases the request without calling its callback.
+ *
+ * @param rpc pointer to the correlation table
+ * @param slot slot returned by mqtt_rpc_prepare()
+ */
+void     __ATTR mqtt_rpc_cancel(mqtt_rpc_t *rpc, uint32_t slot);
+/**
+ * @brief Allocates the request and prepares PUBLISH packet.
+ *
+ * @param rpc pointer to the correlation table
+ * @param cli pointer to the client
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, properties are replaced
+ * @param buf pointer to the buffer used to store the new properties
+ * @param capacity capacity of the buffer
+ * @param cb completion callback
+ * @param arg user argument passed to the callback
+ * @param now current time in seconds
+ *
+ * @returns the same values as mqtt_rpc_prepare() and publish()
+ */
+uint16_t __ATTR mqtt_rpc_request(mqtt_rpc_t *rpc, const mqtt_cli_t *cli, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity, cb_mqtt_rpc_t cb, void *arg, uint32_t now);
+/**
+ * @brief Completes the request matching Correlation Data of the received PUBLISH packet. Shall be called inside publish callback.
+ *
+ * @param rpc pointer to the correlation table
+ * @param self pointer to the callback context
+ * @param pkt pointer to PUBLISH packet structure
+ *
+ * @returns 1 if the packet was the response to the pending request, otherwise 0
+ *
+ * @note The request is found directly by the slot encoded in Correlation Data, no search is done.
+ */
+uint8_t  __ATTR mqtt_rpc_response(mqtt_rpc_t *rpc, const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt);
+/**
+ * @brief Completes the requests which timed out, their callbacks are called with NULL packet.
+ *
+ * @param rpc pointer to the correlation table
+ * @param now current time in seconds
+ *
+ * @returns number of the requests which timed out
+ *
+ * @note Shall be called periodically, e.g. on the same timer which drives process().
+ */
+size_t   __ATTR mqtt_rpc_expire(mqtt_rpc_t *rpc, uint32_t now);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_RPC_H__
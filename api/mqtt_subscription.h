@@ -0,0 +1,90 @@
+#ifndef __MQTT_SUBSCRIPTION_H__
+#define __MQTT_SUBSCRIPTION_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+#include "mqtt_limits.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+  /** Buffer storing the filters in SUBSCRIBE payload format: 2 bytes length, Topic Filter, Subscription Options */
+  uint8_t *value;
+  /** Capacity of the buffer */
+  size_t capacity;
+  /** Length of the stored filters */
+  size_t length;
+  /** Number of the stored filters */
+  uint16_t count;
+  /** Offset of the first filter which shall be restored, equal to length if there is nothing to restore */
+  size_t restore;
+  /** Maximum size of the SUBSCRIBE packet negotiated with the broker */
+  size_t max_packet_size;
+  /** MQTT protocol version */
+  uint8_t version;
+  /** Set of the active subscriptions */
+} mqtt_subscription_set_t;
+
+/**
+ * @brief Initializes the subscription set.
+ *
+ * @param set pointer to the subscription set
+ * @param version MQTT protocol version used by the client
+ * @param buf pointer to the buffer used to store the filters
+ * @param capacity capacity of the buffer
+ */
+void     __ATTR mqtt_subscription_init(mqtt_subscription_set_t *set, uint8_t version, uint8_t *buf, size_t capacity);
+/**
+ * @brief Adds the Topic Filter to the set or updates its Subscription Options if it was already added.
+ *
+ * @param set pointer to the subscription set
+ * @param filter pointer to the Topic Filter and Subscription Options, the value is copied
+ *
+ * @returns MQTT_SUCCESS if the filter was stored, otherwise:
+ *          MQTT_INVALID_ARGS if the Topic Filter is not valid or
+ *          MQTT_OUT_OF_MEM if there is not enough space in the buffer.
+ */
+uint16_t __ATTR mqtt_subscription_add(mqtt_subscription_set_t *set, const mqtt_subscribe_filter_t *filter);
+/**
+ * @brief Removes the Topic Filter from the set.
+ *
+ * @param set pointer to the subscription set
+ * @param filter pointer to the Topic Filter
+ *
+ * @returns MQTT_SUCCESS if the filter was removed, otherwise MQTT_INVALID_ARGS if the filter was not found.
+ */
+uint16_t __ATTR mqtt_subscription_remove(mqtt_subscription_set_t *set, const lv_t *filter);
+/**
+ * @brief Schedules restoring of all subscriptions unless the session was resumed. Shall be called inside connack callback.
+ *
+ * @param set pointer to the subscription set
+ * @param limits pointer to the limits already updated by mqtt_limits_connack(), could be NULL
+ * @param pkt pointer to CONNACK packet structure
+ * @param max_packet_size maximum size of the packet which could be sent, e.g. size of the send buffer
+ *
+ * @note If the broker specified Maximum Packet Size, the lower value is used.
+ */
+void     __ATTR mqtt_subscription_connack(mqtt_subscription_set_t *set, const mqtt_limits_t *limits, const mqtt_connack_t *pkt, size_t max_packet_size);
+/**
+ * @brief Prepares the next SUBSCRIBE packet restoring as many subscriptions as fit into the negotiated packet size.
+ *
+ * @param set pointer to the subscription set
+ * @param cli pointer to the client
+ * @param output pointer to the structure representing outgoing packet data to be send manually, length is 0 if there is nothing to send
+ *
+ * @returns MQTT_SUCCESS if all subscriptions were restored, MQTT_PENDING_DATA if the function shall be called again
+ *          after sending the output, otherwise the error returned by subscribe_ex().
+ *
+ * @note Shall be called outside of the callbacks, e.g. after process() returned.
+ * @note The Packet Identifier is allocated by subscribe_ex(), up to MAX_TOPIC_FILTERS filters are sent in one packet.
+ */
+uint16_t __ATTR mqtt_subscription_restore(mqtt_subscription_set_t *set, const mqtt_cli_t *cli, clv_t *output);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_SUBSCRIPTION_H__
@@ -0,0 +1,94 @@
+#ifndef __MQTT_TOPIC_H__
+#define __MQTT_TOPIC_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Maximum number of levels in the compiled Topic Filter */
+#define MAX_TOPIC_LEVELS      32
+
+typedef struct {
+  /** Topic Filter value, the buffer is not copied and shall be valid as long as the compiled filter is used */
+  const uint8_t *value;
+  /** Offsets of the levels, offset[levels] points one byte past the end of the filter */
+  uint16_t offset[MAX_TOPIC_LEVELS + 1];
+  /** Number of levels */
+  uint8_t levels;
+  /** Bit n is set if level n is the single-level wildcard '+' */
+  uint32_t single;
+  /** Set to 1 if the last level is the multi-level wildcard '#' */
+  uint8_t multi;
+  /** Compiled Topic Filter */
+} mqtt_topic_filter_t;
+
+/**
+ * @brief Validates the Topic Name used in PUBLISH packet.
+ *
+ * @param topic pointer to the Topic Name
+ *
+ * @returns MQTT_SUCCESS if the Topic Name is valid, otherwise:
+ *          MQTT_INVALID_ARGS if the length is out of range, the Topic Name is not well-formed UTF-8,
+ *          contains U+0000 or any wildcard character.
+ *
+ * @note ASCII-only parts of the topic are checked 32 (AVX2), 16 (SSE2, NEON) or 8 (other targets) bytes at a time.
+ */
+uint16_t __ATTR mqtt_topic_validate_name(const lv_t *topic);
+/**
+ * @brief Validates the Topic Filter used in SUBSCRIBE and UNSUBSCRIBE packets.
+ *
+ * @param filter pointer to the Topic Filter
+ *
+ * @returns MQTT_SUCCESS if the Topic Filter is valid, otherwise:
+ *          MQTT_INVALID_ARGS if the length is out of range, the Topic Filter is not well-formed UTF-8,
+ *          contains U+0000 or wildcard characters are used on illegal positions.
+ *
+ * @note '+' shall occupy an entire level, '#' shall occupy the last level only.
+ */
+uint16_t __ATTR mqtt_topic_validate_filter(const lv_t *filter);
+/**
+ * @brief Validates and compiles the Topic Filter into the level offsets form used by the matching functions.
+ *
+ * @param compiled pointer to the compiled filter
+ * @param filter pointer to the Topic Filter
+ *
+ * @returns MQTT_SUCCESS if the Topic Filter was compiled, otherwise:
+ *          MQTT_INVALID_ARGS if the Topic Filter is not valid or has more than MAX_TOPIC_LEVELS levels.
+ *
+ * @note The Topic Filter value is not copied.
+ * @note For Shared Subscriptions ("$share/{ShareName}/{filter}") only the {filter} part is compiled.
+ */
+uint16_t __ATTR mqtt_topic_compile(mqtt_topic_filter_t *compiled, const lv_t *filter);
+/**
+ * @brief Checks if the Topic Name matches the compiled Topic Filter.
+ *
+ * @param filter pointer to the compiled filter
+ * @param topic pointer to the Topic Name
+ *
+ * @returns 1 if the Topic Name matches the filter, otherwise 0
+ *
+ * @note Topic Names starting with '$' are not matched by filters starting with a wildcard.
+ */
+uint8_t  __ATTR mqtt_topic_match(const mqtt_topic_filter_t *filter, const lv_t *topic);
+/**
+ * @brief Finds all compiled Topic Filters matching the Topic Name. The Topic Name is split into levels only once.
+ *
+ * @param filters pointer to the compiled filters
+ * @param count number of the compiled filters
+ * @param topic pointer to the Topic Name
+ * @param matches pointer to the array receiving indices of the matching filters, could be NULL
+ * @param capacity capacity of the matches array
+ *
+ * @returns number of matching filters, indices above capacity are not stored
+ */
+size_t   __ATTR mqtt_topic_match_all(const mqtt_topic_filter_t *filters, size_t count, const lv_t *topic, size_t *matches, size_t capacity);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_TOPIC_H__
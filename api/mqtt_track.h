@@ -0,0 +1,118 @@
+#ifndef __MQTT_TRACK_H__
+#define __MQTT_TRACK_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_cli.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Callback definition for the message completion.
+ * @param arg user argument specified with the message
+ * @param id Packet Identifier of the message, 0 for QoS 0 message
+ * @param rc MQTT_SUCCESS if the message was delivered, MQTT_PKT_REJECTED if PUBACK contains failure Reason Code
+ *           or the value passed to mqtt_track_fail()
+ */
+typedef void (*cb_mqtt_track_t) (void *arg, uint16_t id, uint16_t rc);
+
+typedef struct {
+  /** Completion callback, NULL if the slot is free */
+  cb_mqtt_track_t cb;
+  /** User argument */
+  void *arg;
+  /** Packet Identifier of the message */
+  uint16_t id;
+  /** Single message waiting for PUBACK */
+} mqtt_track_slot_t;
+
+typedef struct {
+  /** Slots of the messages */
+  mqtt_track_slot_t *slots;
+  /** Number of the slots */
+  size_t count;
+  /** Number of the messages waiting for PUBACK */
+  size_t pending;
+  /** Outgoing message completion table */
+} mqtt_track_t;
+
+/**
+ * @brief Initializes the completion table.
+ *
+ * @param track pointer to the completion table
+ * @param slots pointer to the array of slots
+ * @param count number of the slots, e.g. max_pkt_id of the client parameters
+ */
+void     __ATTR mqtt_track_init(mqtt_track_t *track, mqtt_track_slot_t *slots, size_t count);
+/**
+ * @brief Obtains Packet Identifier of PUBLISH packet.
+ *
+ * @param packet pointer to PUBLISH packet, e.g. prepared by publish_ex()
+ * @param id pointer to Packet Identifier, 0 for QoS 0 packet
+ *
+ * @returns MQTT_SUCCESS if Packet Identifier was obtained, otherwise:
+ *          MQTT_MALFORMED_PACKET if the data is not complete PUBLISH packet.
+ */
+uint16_t __ATTR mqtt_track_id(const lv_t *packet, uint16_t *id);
+/**
+ * @brief Adds the completion callback of PUBLISH packet prepared by publish_ex().
+ *
+ * @param track pointer to the completion table
+ * @param packet pointer to PUBLISH packet
+ * @param cb completion callback
+ * @param arg user argument passed to the callback
+ * @param id pointer to Packet Identifier of the packet, could be NULL
+ *
+ * @returns MQTT_SUCCESS if the callback was added, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided,
+ *          MQTT_MALFORMED_PACKET if the data is not complete PUBLISH packet,
+ *          MQTT_NOT_SUPPORTED if the packet is QoS 2 or
+ *          MQTT_NO_PKT_ID if there is no free slot.
+ *
+ * @note QoS 0 message is completed right away, the message was already copied into the packet.
+ */
+uint16_t __ATTR mqtt_track_add(mqtt_track_t *track, const lv_t *packet, cb_mqtt_track_t cb, void *arg, uint16_t *id);
+/**
+ * @brief Prepares PUBLISH packet and adds its completion callback.
+ *
+ * @param track pointer to the completion table
+ * @param cli pointer to the client
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet
+ * @param output pointer to the structure representing outgoing packet data to be send manually
+ * @param cb completion callback
+ * @param arg user argument passed to the callback
+ * @param id pointer to Packet Identifier of the packet, could be NULL
+ *
+ * @returns the same values as mqtt_track_add() and publish_ex()
+ *
+ * @note The slot is checked before the packet is prepared, so the packet is not prepared if there is no free slot.
+ * @note The packet is stored at the beginning of the output like by publish_ex().
+ */
+uint16_t __ATTR mqtt_track_publish(mqtt_track_t *track, const mqtt_cli_t *cli, const mqtt_publish_params_t *params, clv_t *output,
+                                   cb_mqtt_track_t cb, void *arg, uint16_t *id);
+/**
+ * @brief Completes the message acknowledged by PUBACK packet. Shall be called inside puback callback.
+ *
+ * @param track pointer to the completion table
+ * @param pkt pointer to PUBACK packet structure
+ *
+ * @returns 1 if the message was found, otherwise 0
+ */
+uint8_t  __ATTR mqtt_track_puback(mqtt_track_t *track, const mqtt_puback_t *pkt);
+/**
+ * @brief Completes all messages waiting for PUBACK with the specified return code, e.g. when the connection is closed.
+ *
+ * @param track pointer to the completion table
+ * @param rc return code passed to the callbacks, e.g. MQTT_NOT_CONNECTED
+ *
+ * @returns number of the completed messages
+ */
+size_t   __ATTR mqtt_track_fail(mqtt_track_t *track, uint16_t rc);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_TRACK_H__
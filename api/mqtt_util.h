@@ -0,0 +1,37 @@
+#ifndef __MQTT_UTIL_H__
+#define __MQTT_UTIL_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Helpers shared by the modules, they are not needed by the applications */
+
+/**
+ * @brief Calculates size of the single PUBLISH property including its identifier.
+ *
+ * @param buf pointer to the property
+ * @param len number of bytes left in the properties
+ *
+ * @returns size of the property, 0 if the property is malformed or not allowed in PUBLISH packet
+ */
+size_t   __ATTR mqtt_util_property_size(const uint8_t *buf, size_t len);
+/**
+ * @brief Calculates FNV-1a hash of the data, e.g. Topic Name.
+ *
+ * @param buf pointer to the data
+ * @param len length of the data
+ *
+ * @returns hash value
+ */
+uint32_t __ATTR mqtt_util_hash(const uint8_t *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_UTIL_H__
@@ -0,0 +1,487 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>	/* close */
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <errno.h>
+
+#include "broker.h"
+
+/** Single client connection */
+typedef struct broker_conn {
+  /** Socket, -1 if the connection is not used */
+  int sock;
+  /** MQTT protocol's version */
+  uint8_t version;
+  /** Incoming data */
+  uint8_t *in;
+  /** Number of bytes in the incoming data */
+  size_t in_len;
+  /** Capacity of the incoming data */
+  size_t in_cap;
+  /** Outgoing data */
+  uint8_t *out;
+  /** Number of bytes in the outgoing data */
+  size_t out_len;
+  /** Capacity of the outgoing data */
+  size_t out_cap;
+  /** Subscribed Topic Filter */
+  uint8_t filter[256];
+  /** Subscribed Topic Filter length, 0 if not subscribed */
+  size_t filter_len;
+  /** Set to 1 if the subscription is shared */
+  uint8_t shared;
+  /** Granted QoS */
+  uint8_t qos;
+  /** Next Packet Identifier */
+  uint16_t next_id;
+} broker_conn_t;
+
+struct broker {
+  /** Listening socket */
+  int sock;
+  /** Broker thread */
+  pthread_t thread;
+  /** Set to 1 to stop the thread */
+  volatile int stop;
+  /** Connection which receives the next message of the shared subscription */
+  size_t share_next;
+  /** Connections */
+  broker_conn_t conns[BROKER_MAX_CONNS];
+};
+
+static size_t encode_varint(uint8_t *buf, size_t value) {
+  size_t used = 0;
+
+  do {
+    buf[used] = value & 0x7F;
+    value >>= 7;
+    if(value) {
+      buf[used] |= 0x80;
+    }
+    ++used;
+  } while(value);
+
+  return used;
+}
+
+/**
+ * @brief Decodes the Variable Byte Integer.
+ * @return Returns number of bytes used, 0 if more data is needed or -1 if the value is malformed
+ */
+static int decode_varint(const uint8_t *buf, size_t len, size_t *value) {
+  size_t i, multiplier = 1;
+
+  *value = 0;
+  for(i=0; i<len && i<4; ++i) {
+    *value += (buf[i] & 0x7F) * multiplier;
+    multiplier <<= 7;
+    if( !(buf[i] & 0x80) ) {
+      return (int) i + 1;
+    }
+  }
+
+  return (i == 4) ? -1 : 0;
+}
+
+static int conn_reserve(uint8_t **buf, size_t *cap, size_t required) {
+  uint8_t *tmp;
+  size_t size;
+
+  if(required <= *cap) {
+    return 0;
+  }
+  for(size = *cap ? *cap : BROKER_BUFSIZE; size < required; size *= 2) {}
+  if( NULL == (tmp = realloc( *buf, size )) ) {
+    return -1;
+  }
+  *buf = tmp;
+  *cap = size;
+
+  return 0;
+}
+
+static int conn_write(broker_conn_t *conn, const uint8_t *buf, size_t len) {
+  if( 0 != conn_reserve( &conn->out, &conn->out_cap, conn->out_len + len ) ) {
+    return -1;
+  }
+  memcpy( conn->out + conn->out_len, buf, len );
+  conn->out_len += len;
+
+  return 0;
+}
+
+static void conn_close(broker_conn_t *conn) {
+  if(conn->sock >= 0) {
+    close( conn->sock );
+  }
+  free( conn->in );
+  free( conn->out );
+  memset( conn, 0x00, sizeof(broker_conn_t) );
+  conn->sock = -1;
+}
+
+static int conn_flush(broker_conn_t *conn) {
+  ssize_t sent;
+
+  while(conn->out_len) {
+    if( -1 == (sent = send( conn->sock, conn->out, conn->out_len, MSG_NOSIGNAL )) ) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    memmove( conn->out, conn->out + sent, conn->out_len - sent );
+    conn->out_len -= sent;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Writes PUBLISH to the single subscriber.
+ */
+static void broker_deliver(broker_conn_t *dst, const broker_conn_t *src, uint8_t qos, const uint8_t *topic, size_t topic_len,
+  const uint8_t *props, size_t props_len, const uint8_t *payload, size_t payload_len) {
+  uint8_t header[16], props_hdr[4];
+  size_t offset, remaining, used, dst_props_len;
+  uint8_t out_qos;
+
+  out_qos = (qos < dst->qos) ? qos : dst->qos;
+  remaining = 2 + topic_len + (out_qos ? 2 : 0) + payload_len;
+  used = 0;
+  dst_props_len = (src->version >= 5) ? props_len : 0;
+  if(dst->version >= 5) {
+    used = encode_varint( props_hdr, dst_props_len );
+    remaining += used + dst_props_len;
+  }
+
+  offset = 0;
+  header[offset++] = 0x30 | (out_qos << 1);
+  offset += encode_varint( header + offset, remaining );
+  header[offset++] = (uint8_t) (topic_len >> 8);
+  header[offset++] = (uint8_t) (topic_len);
+  conn_write( dst, header, offset );
+  conn_write( dst, topic, topic_len );
+  if(out_qos) {
+    if(0 == ++dst->next_id) {
+      dst->next_id = 1;
+    }
+    header[0] = (uint8_t) (dst->next_id >> 8);
+    header[1] = (uint8_t) (dst->next_id);
+    conn_write( dst, header, 2 );
+  }
+  if(dst->version >= 5) {
+    conn_write( dst, props_hdr, used );
+    conn_write( dst, props, dst_props_len );
+  }
+  conn_write( dst, payload, payload_len );
+}
+
+/**
+ * @brief Forwards PUBLISH to all subscribers with matching Topic Filter and to one of the shared subscribers.
+ */
+static void broker_forward(broker_t *broker, const broker_conn_t *src, uint8_t qos, const uint8_t *topic, size_t topic_len,
+  const uint8_t *props, size_t props_len, const uint8_t *payload, size_t payload_len) {
+  size_t i, idx;
+  broker_conn_t *dst;
+
+  for(i=0; i<BROKER_MAX_CONNS; ++i) {
+    dst = &broker->conns[i];
+    if(dst->sock < 0 || dst->shared || dst->filter_len != topic_len || 0 != memcmp( dst->filter, topic, topic_len )) {
+      continue;
+    }
+    broker_deliver( dst, src, qos, topic, topic_len, props, props_len, payload, payload_len );
+  }
+
+  /* Shared subscribers take turns */
+  for(i=0; i<BROKER_MAX_CONNS; ++i) {
+    idx = (broker->share_next + i) % BROKER_MAX_CONNS;
+    dst = &broker->conns[idx];
+    if(dst->sock < 0 || !dst->shared || dst->filter_len != topic_len || 0 != memcmp( dst->filter, topic, topic_len )) {
+      continue;
+    }
+    broker_deliver( dst, src, qos, topic, topic_len, props, props_len, payload, payload_len );
+    broker->share_next = idx + 1;
+    break;
+  }
+}
+
+/**
+ * @brief Handles single packet.
+ *
+ * @param type first byte of the Fixed Header
+ * @param body packet data following the Fixed Header
+ * @param len length of the packet data
+ *
+ * @return Returns 0 on success, otherwise -1 if the connection shall be closed
+ */
+static int broker_handle(broker_t *broker, broker_conn_t *conn, uint8_t type, const uint8_t *body, size_t len) {
+  static const uint8_t PINGRESP[] = { 0xD0, 0x00 };
+  uint8_t resp[8], qos;
+  size_t offset = 0, topic_len, props_len = 0;
+  int used;
+  const uint8_t *topic, *props = NULL;
+
+  switch(type >> 4) {
+    case 0x01: /* CONNECT */
+      if(len < 7) {
+        return -1;
+      }
+      conn->version = body[6];
+      resp[0] = 0x20;
+      resp[1] = (conn->version >= 5) ? 3 : 2;
+      resp[2] = 0x00;
+      resp[3] = 0x00;
+      resp[4] = 0x00;
+      return conn_write( conn, resp, 2 + resp[1] );
+    case 0x03: /* PUBLISH */
+      qos = (type >> 1) & 0x03;
+      if(len < 2) {
+        return -1;
+      }
+      topic_len = ((size_t) body[0] << 8) | body[1];
+      topic = body + 2;
+      offset = 2 + topic_len;
+      if(qos) {
+        if(offset + 2 > len) {
+          return -1;
+        }
+        resp[0] = 0x40;
+        resp[1] = 0x02;
+        resp[2] = body[offset];
+        resp[3] = body[offset + 1];
+        offset += 2;
+        if( 0 != conn_write( conn, resp, 4 ) ) {
+          return -1;
+        }
+      }
+      if(conn->version >= 5) {
+        if( 0 >= (used = decode_varint( body + offset, len - offset, &props_len )) ) {
+          return -1;
+        }
+        offset += used;
+        props = body + offset;
+        offset += props_len;
+      }
+      if(offset > len) {
+        return -1;
+      }
+      broker_forward( broker, conn, qos, topic, topic_len, props, props_len, body + offset, len - offset );
+      return 0;
+    case 0x08: /* SUBSCRIBE */
+      offset = 2;
+      if(conn->version >= 5) {
+        if( 0 >= (used = decode_varint( body + offset, len - offset, &props_len )) ) {
+          return -1;
+        }
+        offset += used + props_len;
+      }
+      if(offset + 2 > len) {
+        return -1;
+      }
+      topic_len = ((size_t) body[offset] << 8) | body[offset + 1];
+      if(topic_len > sizeof(conn->filter) || offset + 3 + topic_len > len) {
+        return -1;
+      }
+      topic = body + offset + 2;
+      conn->shared = (topic_len > 7 && 0 == memcmp( topic, "$share/", 7 ));
+      if(conn->shared) {
+        /* $share/{ShareName}/{filter}, all Share Names form the same group */
+        for(used=7; (size_t) used<topic_len && topic[used] != '/'; ++used) {}
+        if((size_t) used == topic_len) {
+          return -1;
+        }
+        memcpy( conn->filter, topic + used + 1, topic_len - used - 1 );
+        conn->filter_len = topic_len - used - 1;
+      }
+      else {
+        memcpy( conn->filter, topic, topic_len );
+        conn->filter_len = topic_len;
+      }
+      conn->qos = (body[offset + 2 + topic_len] & 0x03) ? 1 : 0;
+      offset = 0;
+      resp[offset++] = 0x90;
+      resp[offset++] = (conn->version >= 5) ? 4 : 3;
+      resp[offset++] = body[0];
+      resp[offset++] = body[1];
+      if(conn->version >= 5) {
+        resp[offset++] = 0x00;
+      }
+      resp[offset++] = conn->qos;
+      return conn_write( conn, resp, offset );
+    case 0x0A: /* UNSUBSCRIBE */
+      if(len < 2) {
+        return -1;
+      }
+      conn->filter_len = 0;
+      conn->shared = 0;
+      offset = 0;
+      resp[offset++] = 0xB0;
+      resp[offset++] = (conn->version >= 5) ? 4 : 2;
+      resp[offset++] = body[0];
+      resp[offset++] = body[1];
+      if(conn->version >= 5) {
+        resp[offset++] = 0x00;
+        resp[offset++] = 0x00;
+      }
+      return conn_write( conn, resp, offset );
+    case 0x04: /* PUBACK */
+      return 0;
+    case 0x0C: /* PINGREQ */
+      return conn_write( conn, PINGRESP, sizeof(PINGRESP) );
+    case 0x0E: /* DISCONNECT */
+    default:
+      return -1;
+  }
+}
+
+/**
+ * @brief Handles all complete packets available in the incoming data.
+ * @return Returns 0 on success, otherwise -1 if the connection shall be closed
+ */
+static int broker_receive(broker_t *broker, broker_conn_t *conn) {
+  size_t offset = 0, remaining;
+  int used;
+
+  while(conn->in_len - offset >= 2) {
+    if( 0 > (used = decode_varint( conn->in + offset + 1, conn->in_len - offset - 1, &remaining )) ) {
+      return -1;
+    }
+    if(0 == used || conn->in_len - offset < 1 + used + remaining) {
+      break;
+    }
+    if( 0 != broker_handle( broker, conn, conn->in[offset], conn->in + offset + 1 + used, remaining ) ) {
+      return -1;
+    }
+    offset += 1 + used + remaining;
+  }
+  memmove( conn->in, conn->in + offset, conn->in_len - offset );
+  conn->in_len -= offset;
+
+  return 0;
+}
+
+static void broker_accept(broker_t *broker) {
+  int sock, flag = 1;
+  size_t i;
+
+  while( -1 != (sock = accept4( broker->sock, NULL, NULL, SOCK_NONBLOCK )) ) {
+    for(i=0; i<BROKER_MAX_CONNS && broker->conns[i].sock >= 0; ++i) {}
+    if(i == BROKER_MAX_CONNS) {
+      close( sock );
+      continue;
+    }
+    setsockopt( sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag) );
+    broker->conns[i].sock = sock;
+  }
+}
+
+static void *broker_thread(void *arg) {
+  broker_t *broker = (broker_t*) arg;
+  struct pollfd fds[BROKER_MAX_CONNS + 1];
+  broker_conn_t *map[BROKER_MAX_CONNS + 1];
+  broker_conn_t *conn;
+  nfds_t count, i;
+  ssize_t length;
+
+  while(!broker->stop) {
+    fds[0].fd = broker->sock;
+    fds[0].events = POLLIN;
+    count = 1;
+    for(i=0; i<BROKER_MAX_CONNS; ++i) {
+      if(broker->conns[i].sock >= 0) {
+        fds[count].fd = broker->conns[i].sock;
+        fds[count].events = POLLIN | (broker->conns[i].out_len ? POLLOUT : 0);
+        map[count++] = &broker->conns[i];
+      }
+    }
+    if(0 >= poll( fds, count, 100 )) {
+      continue;
+    }
+    if(fds[0].revents & POLLIN) {
+      broker_accept( broker );
+    }
+    for(i=1; i<count; ++i) {
+      conn = map[i];
+      if(fds[i].revents & (POLLIN | POLLERR | POLLHUP)) {
+        if( 0 != conn_reserve( &conn->in, &conn->in_cap, conn->in_len + BROKER_BUFSIZE ) ) {
+          conn_close( conn );
+          continue;
+        }
+        length = recv( conn->sock, conn->in + conn->in_len, conn->in_cap - conn->in_len, 0 );
+        if(0 == length || (-1 == length && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          conn_close( conn );
+          continue;
+        }
+        if(length > 0) {
+          conn->in_len += length;
+          if( 0 != broker_receive( broker, conn ) ) {
+            conn_close( conn );
+            continue;
+          }
+        }
+      }
+    }
+    /* forwarding may fill buffers of any connection */
+    for(i=0; i<BROKER_MAX_CONNS; ++i) {
+      if(broker->conns[i].sock >= 0 && 0 != conn_flush( &broker->conns[i] )) {
+        conn_close( &broker->conns[i] );
+      }
+    }
+  }
+
+  return NULL;
+}
+
+int broker_start(broker_t **broker, uint16_t *port) {
+  struct sockaddr_in addr;
+  socklen_t addr_len = sizeof(addr);
+  broker_t *b;
+  size_t i;
+
+  if( NULL == (b = calloc( 1, sizeof(broker_t) )) ) {
+    return -1;
+  }
+  for(i=0; i<BROKER_MAX_CONNS; ++i) {
+    b->conns[i].sock = -1;
+  }
+
+  memset( &addr, 0x00, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  addr.sin_port = 0;
+  if( -1 == (b->sock = socket( AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0 ))
+    || 0 != bind( b->sock, (struct sockaddr*) &addr, sizeof(addr) )
+    || 0 != listen( b->sock, BROKER_MAX_CONNS )
+    || 0 != getsockname( b->sock, (struct sockaddr*) &addr, &addr_len )
+    || 0 != pthread_create( &b->thread, NULL, broker_thread, b ) ) {
+    if(b->sock >= 0) {
+      close( b->sock );
+    }
+    free( b );
+    return -1;
+  }
+
+  *port = ntohs( addr.sin_port );
+  *broker = b;
+
+  return 0;
+}
+
+void broker_stop(broker_t *broker) {
+  size_t i;
+
+  if(broker) {
+    broker->stop = 1;
+    pthread_join( broker->thread, NULL );
+    for(i=0; i<BROKER_MAX_CONNS; ++i) {
+      conn_close( &broker->conns[i] );
+    }
+    close( broker->sock );
+    free( broker );
+  }
+}
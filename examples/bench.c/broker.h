@@ -0,0 +1,34 @@
+#ifndef __BROKER_H__
+#define __BROKER_H__
+
+#include <stdint.h>
+
+/** Maximum number of connections handled by the broker */
+#define BROKER_MAX_CONNS    256
+/** Initial size of the connection buffers */
+#define BROKER_BUFSIZE      (64 * 1024)
+
+typedef struct broker broker_t;
+
+/**
+ * @brief Starts minimal MQTT broker stand-in listening on 127.0.0.1 in a separate thread.
+ *
+ * @param broker pointer to the created broker
+ * @param port pointer to the port number the broker is listening on
+ *
+ * @returns 0 on success, otherwise -1
+ *
+ * @note The broker handles CONNECT, SUBSCRIBE, PUBLISH (QoS 0 and 1), PUBACK, PINGREQ and DISCONNECT packets.
+ * @note Topic Filters are matched exactly, wildcards are not supported.
+ * @note Shared subscribers ($share/{ShareName}/{filter}) receive the messages in turns, regardless of the Share Name.
+ */
+int broker_start(broker_t **broker, uint16_t *port);
+
+/**
+ * @brief Stops the broker and releases its resources.
+ *
+ * @param broker pointer to the broker
+ */
+void broker_stop(broker_t *broker);
+
+#endif /* __BROKER_H__ */
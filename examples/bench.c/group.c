@@ -0,0 +1,450 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>	/* close */
+#include <fcntl.h>
+#include <poll.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <time.h> /* clock_gettime() */
+
+#include "group.h"
+#include "broker.h"
+
+/** Program context */
+static context_t ctx;
+/** Publisher, used by the callbacks */
+static group_publisher_t publisher;
+
+static struct option long_options[] = {
+  {L_OPT_MEMBERS,      required_argument,  0,  S_OPT_MEMBERS},
+  {L_OPT_THREADS,      required_argument,  0,  S_OPT_THREADS},
+  {L_OPT_MESSAGES,     required_argument,  0,  S_OPT_MESSAGES},
+  {L_OPT_PAYLOAD,      required_argument,  0,  S_OPT_PAYLOAD},
+  {L_OPT_REBALANCE,    required_argument,  0,  S_OPT_REBALANCE},
+  {L_OPT_SLOW,         required_argument,  0,  S_OPT_SLOW},
+  {L_OPT_MQTT_VERSION, required_argument,  0,  S_OPT_MQTT_VERSION},
+  {NULL,               no_argument,        0,  0}
+};
+
+/**
+ * @brief Parse the command line arguments and set some global flags.
+ * @param argc Number of arguments passed to program
+ * @param argv Values of arguments
+ */
+int validate_args(int argc, char **argv) {
+  int idx, c;
+
+  /* Set default values */
+  memset( &ctx, 0x00, sizeof(context_t) );
+  ctx.members = DEFAULT_MEMBERS;
+  ctx.threads = DEFAULT_THREADS;
+  ctx.messages = DEFAULT_MESSAGES;
+  ctx.payload_len = DEFAULT_PAYLOAD_LEN;
+  ctx.mqtt_version = DEFAULT_VERSION;
+
+  while( 1 ) {
+    c = getopt_long( argc, argv,"k:t:n:p:r:s:", long_options, &idx );
+    /* Detect the end of the options */
+    if( c == -1) {
+      break;
+    }
+    switch(c) {
+      case S_OPT_MEMBERS:
+        ctx.members = atol( optarg );
+        break;
+      case S_OPT_THREADS:
+        ctx.threads = atol( optarg );
+        break;
+      case S_OPT_MESSAGES:
+        ctx.messages = atol( optarg );
+        break;
+      case S_OPT_PAYLOAD:
+        ctx.payload_len = atol( optarg );
+        break;
+      case S_OPT_REBALANCE:
+        ctx.rebalance = atol( optarg );
+        break;
+      case S_OPT_SLOW:
+        ctx.slow_us = atol( optarg );
+        break;
+      case S_OPT_MQTT_VERSION:
+        ctx.mqtt_version = atoi( optarg );
+        break;
+      default:
+        return RESULT_FAILURE;
+    }
+  }
+
+  if(ctx.members <= 0 || ctx.members >= BROKER_MAX_CONNS || ctx.members > MQTT_GROUP_MAX_MEMBERS
+    || ctx.threads <= 0 || ctx.threads > ctx.members || ctx.messages <= 0
+    || ctx.payload_len < 0 || ctx.payload_len > GROUP_BUFSIZE / 2
+    || ctx.rebalance < 0 || ctx.rebalance > GROUP_SOCKBUF || ctx.slow_us < 0) {
+    return RESULT_FAILURE;
+  }
+  if(ctx.mqtt_version != 4 && ctx.mqtt_version != 5) {
+    return RESULT_FAILURE;
+  }
+
+  return RESULT_OK;
+}
+
+/**
+ * @brief Prints available options for the program
+ */
+void usage(const char* program) {
+  printf("NAME\r\n");
+  printf("       %s\r\n", program);
+  printf("SYNOPSIS\r\n");
+  printf("       %s %s", program, "[options]\r\n");
+  printf("OPTIONS\r\n");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_MEMBERS,   L_OPT_MEMBERS,          "Sets the number of the group members.");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_THREADS,   L_OPT_THREADS,          "Sets the number of the worker threads.");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_MESSAGES,  L_OPT_MESSAGES,         "Sets the number of published messages.");
+  printf(" -%c length, --%s length\r\n\t%s\r\n",       S_OPT_PAYLOAD,   L_OPT_PAYLOAD,          "Sets the payload length.");
+  printf(" -%c bytes, --%s bytes\r\n\t%s\r\n",         S_OPT_REBALANCE, L_OPT_REBALANCE,        "Sets the backlog which pauses the member.");
+  printf(" -%c time, --%s time\r\n\t%s\r\n",           S_OPT_SLOW,      L_OPT_SLOW,             "Sets the time in microseconds spent by the first member on each message.");
+  printf(" --%s version\r\n\t%s\r\n",                  L_OPT_MQTT_VERSION,                      "Sets MQTT protocol's version. Values 4 and 5 are allowed.");
+  printf("\r\n");
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief Simulates the slow consumer, the first member spends the specified time on each message.
+ */
+static void cb_message(void *arg, size_t member, const mqtt_publish_t *pkt) {
+  uint64_t until;
+
+  if(member == 0 && ctx.slow_us) {
+    until = now_ns() + (uint64_t) ctx.slow_us * 1000ULL;
+    while(now_ns() < until) {}
+  }
+}
+
+mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
+  publisher.connected = (pkt->rc == 0);
+
+  return RC_SUCCESS;
+}
+
+/**
+ * @brief Processes the data and appends all prepared packets to the publisher's outgoing data. Shall be called with the library lock held.
+ * @param length Number of bytes stored in the publisher's io buffer
+ * @return Returns the last process() return code
+ */
+static uint16_t publisher_process(size_t length) {
+  clv_t data = { .capacity=sizeof(publisher.io), .length=length, .value=publisher.io };
+  uint16_t rc;
+
+  do {
+    rc = publisher.cli.process( &publisher.cli, &data, NULL );
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      break;
+    }
+    if(data.length) {
+      if(publisher.out_len + data.length > sizeof(publisher.out)) {
+        return MQTT_OUT_OF_MEM;
+      }
+      memcpy( publisher.out + publisher.out_len, data.value, data.length );
+      publisher.out_len += data.length;
+    }
+    data.length = 0;
+  } while( rc == MQTT_PENDING_DATA );
+
+  return rc;
+}
+
+/**
+ * @brief Receives and processes the broker's responses without blocking.
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t publisher_receive(void) {
+  size_t offset = 0, length;
+  ssize_t received;
+  uint16_t rc = MQTT_SUCCESS;
+
+  received = recv( publisher.sock, publisher.in + publisher.in_len, sizeof(publisher.in) - publisher.in_len, 0 );
+  if(0 == received || (-1 == received && errno != EAGAIN && errno != EWOULDBLOCK)) {
+    return MQTT_NOT_CONNECTED;
+  }
+  if(received <= 0) {
+    return MQTT_SUCCESS;
+  }
+  publisher.in_len += received;
+
+  /* The broker stand-in sends CONNACK and PINGRESP only, their Remaining Length fits into one byte */
+  mqtt_group_lock();
+  while(publisher.in_len - offset >= 2) {
+    if(publisher.in[offset + 1] & 0x80) {
+      rc = MQTT_MALFORMED_PACKET;
+      break;
+    }
+    length = 2 + publisher.in[offset + 1];
+    if(publisher.in_len - offset < length) {
+      break;
+    }
+    memcpy( publisher.io, publisher.in + offset, length );
+    if( MQTT_SUCCESS != (rc = publisher_process( length )) ) {
+      break;
+    }
+    offset += length;
+  }
+  mqtt_group_unlock();
+  memmove( publisher.in, publisher.in + offset, publisher.in_len - offset );
+  publisher.in_len -= offset;
+
+  return rc;
+}
+
+/**
+ * @brief Sends as much outgoing data as possible without blocking.
+ * @return Returns 0 on success, otherwise -1
+ */
+static int publisher_flush(void) {
+  ssize_t sent;
+
+  while(publisher.out_len) {
+    if( -1 == (sent = send( publisher.sock, publisher.out, publisher.out_len, MSG_NOSIGNAL )) ) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    memmove( publisher.out, publisher.out + sent, publisher.out_len - sent );
+    publisher.out_len -= sent;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Connects the publisher to the broker and prepares CONNECT packet.
+ * @param port Broker's port
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t publisher_open(uint16_t port) {
+  struct sockaddr_in addr;
+  mqtt_params_t params = { .bufsize=GROUP_BUFSIZE, .max_pkt_id=GROUP_MAX_PKT_ID, .timeout=1, .version=ctx.mqtt_version };
+  lv_t userid = { .length=9, .value=(uint8_t*) "publisher" };
+  int flag = 1;
+  uint16_t rc;
+
+  memset( &addr, 0x00, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  addr.sin_port = htons( port );
+  if( -1 == (publisher.sock = socket( AF_INET, SOCK_STREAM, 0 ))
+    || 0 != connect( publisher.sock, (struct sockaddr*) &addr, sizeof(addr) ) ) {
+    return MQTT_NOT_CONNECTED;
+  }
+  setsockopt( publisher.sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag) );
+  fcntl( publisher.sock, F_SETFL, fcntl( publisher.sock, F_GETFL, 0 ) | O_NONBLOCK );
+
+  /* The worker threads of the group call the library as well */
+  mqtt_group_lock();
+  if( MQTT_SUCCESS == (rc = mqtt_cli_init_ex( &publisher.cli, &params )) ) {
+    publisher.initialized = 1;
+    publisher.cli.set_cb_connack( &publisher.cli, cb_connack );
+    if( MQTT_SUCCESS == (rc = publisher.cli.set_br_userid( &publisher.cli, &userid )) ) {
+      /* CONNECT */
+      rc = publisher_process( 0 );
+    }
+  }
+  mqtt_group_unlock();
+
+  return rc;
+}
+
+/**
+ * @brief Publishes messages until the outgoing data is full.
+ * @param params Parameters of the published messages
+ * @param sent Pointer to the number of published messages
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t publisher_publish(const mqtt_publish_params_t *params, long *sent) {
+  uint16_t rc = MQTT_SUCCESS;
+
+  mqtt_group_lock();
+  while(*sent < ctx.messages && publisher.out_len + params->message.length + params->topic.length + 16 <= sizeof(publisher.out)) {
+    clv_t output = { .capacity=sizeof(publisher.out) - publisher.out_len, .value=publisher.out + publisher.out_len };
+
+    if(MQTT_SUCCESS != (rc = publisher.cli.publish_ex( &publisher.cli, params, &output ))) {
+      break;
+    }
+    publisher.out_len += output.length;
+    ++*sent;
+  }
+  mqtt_group_unlock();
+
+  return rc;
+}
+
+int main(int argc, char** argv) {
+  static uint8_t payload[GROUP_BUFSIZE];
+  broker_t *broker = NULL;
+  mqtt_group_t *group = NULL;
+  mqtt_group_params_t group_params;
+  mqtt_group_stats_t *stats = NULL;
+  mqtt_publish_params_t params;
+  size_t *max_backlog = NULL, *max_lag = NULL;
+  struct pollfd fd;
+  uint64_t start_ns, end_ns, sample_ns, last_rx_ns, received = 0, last_received = 0;
+  uint16_t port, rc;
+  long i, sent = 0, subscribed;
+  int result;
+  double elapsed_s;
+
+  if( RESULT_OK != (result = validate_args( argc, argv )) ) {
+    usage( PROGRAM_NAME );
+    return result;
+  }
+  result = RESULT_FAILURE;
+  publisher.sock = -1;
+
+  if(0 != broker_start( &broker, &port )) {
+    fprintf( stderr, "Unable to start the broker\n" );
+    return RESULT_FAILURE;
+  }
+  stats = calloc( ctx.members, sizeof(mqtt_group_stats_t) );
+  max_backlog = calloc( ctx.members, sizeof(size_t) );
+  max_lag = calloc( ctx.members, sizeof(size_t) );
+  if(NULL == stats || NULL == max_backlog || NULL == max_lag) {
+    fprintf( stderr, "Out of memory\n" );
+    goto finish;
+  }
+
+  memset( &group_params, 0x00, sizeof(group_params) );
+  group_params.ip = htonl( INADDR_LOOPBACK );
+  group_params.port = port;
+  group_params.share_name.length = sizeof(GROUP_SHARE_NAME) - 1;
+  group_params.share_name.value = (uint8_t*) GROUP_SHARE_NAME;
+  group_params.filter.length = sizeof(GROUP_TOPIC) - 1;
+  group_params.filter.value = (uint8_t*) GROUP_TOPIC;
+  group_params.userid.length = 11;
+  group_params.userid.value = (uint8_t*) "groupmember";
+  group_params.members = ctx.members;
+  group_params.threads = ctx.threads;
+  group_params.sockbuf = GROUP_SOCKBUF;
+  group_params.pause_backlog = ctx.rebalance;
+  group_params.resume_backlog = ctx.rebalance / 2;
+  group_params.cb = cb_message;
+  group_params.params.bufsize = GROUP_BUFSIZE;
+  group_params.params.max_pkt_id = GROUP_MAX_PKT_ID;
+  group_params.params.timeout = 1;
+  group_params.params.version = ctx.mqtt_version;
+  if( MQTT_SUCCESS != (rc = mqtt_group_start( &group, &group_params )) ) {
+    fprintf( stderr, "Unable to start the group: 0x%04X\n", rc );
+    goto finish;
+  }
+
+  /* Waiting for all subscriptions, so the broker shares the messages among all members */
+  start_ns = now_ns();
+  do {
+    mqtt_group_stats( group, stats );
+    for(i=0, subscribed=0; i<ctx.members; ++i) {
+      subscribed += stats[i].subscribed;
+    }
+    if(now_ns() - start_ns >= GROUP_TIMEOUT * 1000000000ULL) {
+      fprintf( stderr, "Members not subscribed within %d seconds\n", GROUP_TIMEOUT );
+      goto finish;
+    }
+    usleep( GROUP_SAMPLE_MS * 1000 );
+  } while( subscribed < ctx.members );
+
+  if( MQTT_SUCCESS != (rc = publisher_open( port )) ) {
+    fprintf( stderr, "Unable to connect the publisher: 0x%04X\n", rc );
+    goto finish;
+  }
+
+  memset( payload, 0xA5, sizeof(payload) );
+  memset( &params, 0x00, sizeof(params) );
+  params.topic.length = sizeof(GROUP_TOPIC) - 1;
+  params.topic.value = (uint8_t*) GROUP_TOPIC;
+  params.message.length = ctx.payload_len;
+  params.message.value = payload;
+
+  start_ns = sample_ns = last_rx_ns = now_ns();
+  fd.fd = publisher.sock;
+  do {
+    if(publisher.connected && MQTT_SUCCESS != (rc = publisher_publish( &params, &sent ))) {
+      fprintf( stderr, "Publishing failed: 0x%04X\n", rc );
+      goto finish;
+    }
+    if(0 != publisher_flush()) {
+      fprintf( stderr, "Sending failed\n" );
+      goto finish;
+    }
+    fd.events = POLLIN | (publisher.out_len ? POLLOUT : 0);
+    if(0 < poll( &fd, 1, 1 ) && (fd.revents & (POLLIN | POLLERR | POLLHUP))
+      && MQTT_SUCCESS != (rc = publisher_receive())) {
+      fprintf( stderr, "Processing failed: 0x%04X\n", rc );
+      goto finish;
+    }
+
+    end_ns = now_ns();
+    if(end_ns - sample_ns < GROUP_SAMPLE_MS * 1000000ULL) {
+      continue;
+    }
+    sample_ns = end_ns;
+    mqtt_group_stats( group, stats );
+    for(i=0, received=0; i<ctx.members; ++i) {
+      received += stats[i].messages;
+      if(stats[i].backlog > max_backlog[i]) {
+        max_backlog[i] = stats[i].backlog;
+      }
+      if(stats[i].lag > max_lag[i]) {
+        max_lag[i] = stats[i].lag;
+      }
+    }
+    if(received != last_received) {
+      last_received = received;
+      last_rx_ns = end_ns;
+    }
+    if(end_ns - last_rx_ns >= GROUP_TIMEOUT * 1000000000ULL) {
+      fprintf( stderr, "No messages received within %d seconds\n", GROUP_TIMEOUT );
+      goto finish;
+    }
+  } while( received < (uint64_t) ctx.messages );
+  elapsed_s = (double) (end_ns - start_ns) / 1e9;
+
+  printf("version,members,threads,member,messages,msgs_per_s,mb_per_s,max_backlog,max_lag,pauses\n");
+  for(i=0; i<ctx.members; ++i) {
+    printf("%u,%ld,%ld,%ld,%llu,%.0f,%.2f,%zu,%zu,%llu\n",
+      ctx.mqtt_version, ctx.members, ctx.threads, i, (unsigned long long) stats[i].messages,
+      (double) stats[i].messages / elapsed_s, (double) stats[i].bytes / elapsed_s / 1e6, max_backlog[i], max_lag[i],
+      (unsigned long long) stats[i].pauses);
+  }
+  printf("%u,%ld,%ld,all,%llu,%.0f,%.2f,,,\n",
+    ctx.mqtt_version, ctx.members, ctx.threads, (unsigned long long) received,
+    (double) received / elapsed_s, (double) received * ctx.payload_len / elapsed_s / 1e6);
+  result = RESULT_OK;
+
+finish:
+  mqtt_group_stop( group );
+  if(publisher.initialized) {
+    mqtt_group_lock();
+    publisher.cli.disconnect( &publisher.cli );
+    publisher_process( 0 );
+    mqtt_cli_destr( &publisher.cli );
+    mqtt_group_unlock();
+    publisher_flush();
+  }
+  if(publisher.sock >= 0) {
+    close( publisher.sock );
+  }
+  broker_stop( broker );
+  free( stats );
+  free( max_backlog );
+  free( max_lag );
+
+  return result;
+}
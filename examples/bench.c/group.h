@@ -0,0 +1,110 @@
+#ifndef __GROUP_H__
+#define __GROUP_H__
+
+#include "../../api/mqtt_group.h"
+
+/** Program name */
+#define PROGRAM_NAME      "group"
+/** Program's author */
+#define PROGRAM_AUTHOR    "Jakub Piwowarczyk"
+/** Program's version*/
+#define PROGRAM_VERSION   "1.0.0.0"
+
+#define RESULT_OK         (int) (0)
+#define RESULT_FAILURE    (int) (65535)
+
+/** Default number of the group members */
+#define DEFAULT_MEMBERS     8
+/** Default number of the worker threads */
+#define DEFAULT_THREADS     2
+/** Default number of published messages */
+#define DEFAULT_MESSAGES    100000
+/** Default payload length */
+#define DEFAULT_PAYLOAD_LEN 128
+/** Default MQTT protocol's version */
+#define DEFAULT_VERSION     5
+/** Internal buffer size used by the clients */
+#define GROUP_BUFSIZE       4096
+/** Maximum number of packet identifiers used by the clients */
+#define GROUP_MAX_PKT_ID    8
+/** Size of the socket buffers of each client */
+#define GROUP_SOCKBUF       (64 * 1024)
+/** Topic used to publish and subscribe */
+#define GROUP_TOPIC         "bench/group"
+/** Share Name */
+#define GROUP_SHARE_NAME    "bench"
+/** Backlog is sampled with the specified period in milliseconds */
+#define GROUP_SAMPLE_MS     10
+/** Run is aborted when no message is received for the specified number of seconds */
+#define GROUP_TIMEOUT       10
+
+/** Short option: members */
+#define S_OPT_MEMBERS       'k'
+/** Long option: members */
+#define L_OPT_MEMBERS       "members"
+/** Short option: threads */
+#define S_OPT_THREADS       't'
+/** Long option: threads */
+#define L_OPT_THREADS       "threads"
+/** Short option: messages */
+#define S_OPT_MESSAGES      'n'
+/** Long option: messages */
+#define L_OPT_MESSAGES      "messages"
+/** Short option: payload */
+#define S_OPT_PAYLOAD       'p'
+/** Long option: payload */
+#define L_OPT_PAYLOAD       "payload"
+/** Short option: rebalance */
+#define S_OPT_REBALANCE     'r'
+/** Long option: rebalance */
+#define L_OPT_REBALANCE     "rebalance"
+/** Short option: slow */
+#define S_OPT_SLOW          's'
+/** Long option: slow */
+#define L_OPT_SLOW          "slow"
+/** Short option: mqtt-version */
+#define S_OPT_MQTT_VERSION  '\3'
+/** Long option: mqtt-version */
+#define L_OPT_MQTT_VERSION  "mqtt-version"
+
+/** @brief Program context definition */
+typedef struct program_ctx {
+  /** Number of the group members */
+  long members;
+  /** Number of the worker threads */
+  long threads;
+  /** Number of published messages */
+  long messages;
+  /** Payload length */
+  long payload_len;
+  /** Backlog in bytes which pauses the member, 0 disables rebalancing */
+  long rebalance;
+  /** Time in microseconds spent by the first member on each message */
+  long slow_us;
+  /** MQTT protocol's version */
+  uint8_t mqtt_version;
+} context_t;
+
+/** @brief Publisher feeding the group */
+typedef struct group_publisher {
+  /** Library client */
+  mqtt_cli_t cli;
+  /** Socket connected to the broker, -1 if not connected */
+  int sock;
+  /** Set to 1 once the client is initialized */
+  uint8_t initialized;
+  /** Set to 1 once CONNACK is received */
+  uint8_t connected;
+  /** Received data not processed yet */
+  uint8_t in[GROUP_BUFSIZE];
+  /** Number of bytes in the received data */
+  size_t in_len;
+  /** Data to send */
+  uint8_t out[GROUP_SOCKBUF];
+  /** Number of bytes in the data to send */
+  size_t out_len;
+  /** Buffer passed to the process() function */
+  uint8_t io[GROUP_BUFSIZE];
+} group_publisher_t;
+
+#endif /* __GROUP_H__ */
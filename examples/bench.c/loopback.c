@@ -0,0 +1,580 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <unistd.h>	/* close */
+#include <fcntl.h>
+#include <poll.h>
+#include <getopt.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <time.h> /* clock_gettime() */
+
+#include "loopback.h"
+#include "broker.h"
+
+/** Program context */
+static context_t ctx;
+
+/** Client being processed, used by the callbacks */
+static loopback_client_t *current;
+/** QoS of the current run */
+static uint8_t run_qos;
+/** Latencies of all received messages in nanoseconds */
+static uint64_t *latencies;
+/** Number of the stored latencies */
+static size_t latencies_len;
+/** Time of the last received message */
+static uint64_t last_rx_ns;
+
+/** Swept payload lengths, the first 8 bytes carry the publish timestamp */
+static const size_t PAYLOAD_LENS[] = { 16, 128, 1024 };
+/** Swept QoS levels */
+static const uint8_t QOS_LEVELS[] = { 0, 1 };
+
+static struct option long_options[] = {
+  {L_OPT_CLIENTS,      required_argument,  0,  S_OPT_CLIENTS},
+  {L_OPT_MESSAGES,     required_argument,  0,  S_OPT_MESSAGES},
+  {L_OPT_WINDOW,       required_argument,  0,  S_OPT_WINDOW},
+  {L_OPT_RATE,         required_argument,  0,  S_OPT_RATE},
+  {L_OPT_MQTT_VERSION, required_argument,  0,  S_OPT_MQTT_VERSION},
+  {NULL,               no_argument,        0,  0}
+};
+
+/**
+ * @brief Parse the command line arguments and set some global flags.
+ * @param argc Number of arguments passed to program
+ * @param argv Values of arguments
+ */
+int validate_args(int argc, char **argv) {
+  int idx, c;
+
+  /* Set default values */
+  memset( &ctx, 0x00, sizeof(context_t) );
+  ctx.clients = DEFAULT_CLIENTS;
+  ctx.messages = DEFAULT_MESSAGES;
+  ctx.window = DEFAULT_WINDOW;
+  ctx.mqtt_version = DEFAULT_VERSION;
+
+  while( 1 ) {
+    c = getopt_long( argc, argv,"c:n:w:r:", long_options, &idx );
+    /* Detect the end of the options */
+    if( c == -1) {
+      break;
+    }
+    switch(c) {
+      case S_OPT_CLIENTS:
+        ctx.clients = atol( optarg );
+        break;
+      case S_OPT_MESSAGES:
+        ctx.messages = atol( optarg );
+        break;
+      case S_OPT_WINDOW:
+        ctx.window = atol( optarg );
+        break;
+      case S_OPT_RATE:
+        ctx.rate = atol( optarg );
+        break;
+      case S_OPT_MQTT_VERSION:
+        ctx.mqtt_version = atoi( optarg );
+        break;
+      default:
+        return RESULT_FAILURE;
+    }
+  }
+
+  if(ctx.clients <= 0 || ctx.clients >= BROKER_MAX_CONNS || ctx.messages <= 0 || ctx.window <= 0 || ctx.rate < 0) {
+    return RESULT_FAILURE;
+  }
+  if(ctx.mqtt_version != 4 && ctx.mqtt_version != 5) {
+    return RESULT_FAILURE;
+  }
+
+  return RESULT_OK;
+}
+
+/**
+ * @brief Prints available options for the program
+ */
+void usage(const char* program) {
+  printf("NAME\r\n");
+  printf("       %s\r\n", program);
+  printf("SYNOPSIS\r\n");
+  printf("       %s %s", program, "[options]\r\n");
+  printf("OPTIONS\r\n");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_CLIENTS,   L_OPT_CLIENTS,          "Sets the number of clients.");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_MESSAGES,  L_OPT_MESSAGES,         "Sets the number of messages published by each client.");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_WINDOW,    L_OPT_WINDOW,           "Sets the number of messages in flight per client.");
+  printf(" -%c rate, --%s rate\r\n\t%s\r\n",           S_OPT_RATE,      L_OPT_RATE,             "Sets the number of messages published per second by each client.");
+  printf(" --%s version\r\n\t%s\r\n",                  L_OPT_MQTT_VERSION,                      "Sets MQTT protocol's version. Values 4 and 5 are allowed.");
+  printf("\r\n");
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+static int compare_u64(const void *a, const void *b) {
+  uint64_t x = *(const uint64_t*) a, y = *(const uint64_t*) b;
+
+  return (x > y) - (x < y);
+}
+
+mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
+  mqtt_subscribe_params_t params;
+
+  memset( &params, 0x00, sizeof(params) );
+  params.filter.length = current->topic_len;
+  params.filter.value = (uint8_t*) current->topic;
+  params.filter.options = run_qos;
+  self->subscribe( self, &params );
+
+  return RC_SUCCESS;
+}
+
+void cb_suback(const mqtt_cli_ctx_cb_t *self, const mqtt_suback_t *pkt, const mqtt_channel_t *channel) {
+  current->subscribed = 1;
+}
+
+void cb_puback(const mqtt_cli_ctx_cb_t *self, const mqtt_puback_t *pkt, const mqtt_channel_t *channel) {
+  mqtt_track_puback( &current->track, pkt );
+}
+
+mqtt_rc_t cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, const mqtt_channel_t *channel) {
+  uint64_t sent_ns;
+
+  if(pkt->message.length >= sizeof(sent_ns)) {
+    memcpy( &sent_ns, pkt->message.value, sizeof(sent_ns) );
+    last_rx_ns = now_ns();
+    latencies[latencies_len++] = last_rx_ns - sent_ns;
+  }
+  ++current->received;
+
+  return RC_SUCCESS;
+}
+
+/**
+ * @brief Counts the completed message.
+ * @param arg Client which published the message
+ * @param id Packet Identifier of the message
+ * @param rc Completion return code
+ */
+static void cb_track(void *arg, uint16_t id, uint16_t rc) {
+  loopback_client_t *client = arg;
+
+  if(rc == MQTT_SUCCESS) {
+    ++client->completed;
+  }
+  else {
+    ++client->failed;
+  }
+}
+
+/**
+ * @brief Processes the data and appends all prepared packets to the client's outgoing data.
+ * @param client Client to use
+ * @param length Number of bytes stored in the client's io buffer
+ * @return Returns the last process() return code
+ */
+static uint16_t client_process(loopback_client_t *client, size_t length) {
+  clv_t data = { .capacity=sizeof(client->io), .length=length, .value=client->io };
+  uint16_t rc;
+
+  current = client;
+  do {
+    rc = client->cli.process( &client->cli, &data, NULL );
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      break;
+    }
+    if(data.length) {
+      if(client->out_len + data.length > sizeof(client->out)) {
+        return MQTT_OUT_OF_MEM;
+      }
+      memcpy( client->out + client->out_len, data.value, data.length );
+      client->out_len += data.length;
+    }
+    data.length = 0;
+  } while( rc == MQTT_PENDING_DATA );
+
+  return rc;
+}
+
+/**
+ * @brief Processes all complete packets available in the received data.
+ * @param client Client to use
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t client_receive(loopback_client_t *client) {
+  size_t offset = 0, length, remaining, multiplier, used;
+  uint16_t rc;
+
+  while(client->in_len - offset >= 2) {
+    remaining = 0;
+    multiplier = 1;
+    for(used=1; used<=4 && offset+used<client->in_len; ++used) {
+      remaining += (client->in[offset+used] & 0x7F) * multiplier;
+      multiplier <<= 7;
+      if( !(client->in[offset+used] & 0x80) ) {
+        break;
+      }
+    }
+    if(used > 4) {
+      return MQTT_MALFORMED_PACKET;
+    }
+    length = 1 + used + remaining;
+    if(offset + used >= client->in_len || client->in_len - offset < length) {
+      break;
+    }
+    if(length > sizeof(client->io)) {
+      return MQTT_MALFORMED_PACKET;
+    }
+    memcpy( client->io, client->in + offset, length );
+    if( MQTT_SUCCESS != (rc = client_process( client, length )) ) {
+      return rc;
+    }
+    offset += length;
+  }
+  memmove( client->in, client->in + offset, client->in_len - offset );
+  client->in_len -= offset;
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Publishes single message if the rate limit allows it.
+ * @param client Client to use
+ * @param params Parameters of the message
+ * @param now_ms Current time in milliseconds
+ * @return Returns MQTT_THROTTLED if the message shall be published later, MQTT_SUCCESS on success,
+ *         otherwise the failed operation return code
+ */
+static uint16_t client_publish_limited(loopback_client_t *client, const mqtt_publish_params_t *params, uint32_t now_ms) {
+  lv_t packet;
+  size_t offset = client->out_len;
+  uint32_t wait;
+  uint16_t rc;
+
+  if((int32_t) (now_ms - client->resume_ms) < 0) {
+    return MQTT_THROTTLED;
+  }
+  if(MQTT_THROTTLED == (rc = mqtt_ratelimit_publish( &client->limit, &client->cli, params, now_ms, &wait ))) {
+    /* The reported wait shall be enough to refill the bucket, so the next attempt is never throttled */
+    client->rethrottled += client->waiting;
+    client->waiting = 1;
+    client->resume_ms = now_ms + wait;
+    ++client->throttled;
+    return rc;
+  }
+  client->waiting = 0;
+  if(rc != MQTT_SUCCESS) {
+    return rc;
+  }
+
+  /* The packet prepared by publish() is returned by the following process() */
+  if(MQTT_SUCCESS != (rc = client_process( client, 0 ))) {
+    return rc;
+  }
+  packet.length = client->out_len - offset;
+  packet.value = client->out + offset;
+
+  return mqtt_track_add( &client->track, &packet, cb_track, client, NULL );
+}
+
+/**
+ * @brief Publishes messages until the window is full.
+ * @param client Client to use
+ * @param payload Payload of the messages
+ * @param payload_len Payload length
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t client_publish(loopback_client_t *client, uint8_t *payload, size_t payload_len) {
+  mqtt_publish_params_t params;
+  uint64_t sent_ns;
+  uint16_t rc;
+
+  memset( &params, 0x00, sizeof(params) );
+  params.flags = run_qos << 1;
+  params.topic.length = client->topic_len;
+  params.topic.value = (uint8_t*) client->topic;
+  params.message.length = payload_len;
+  params.message.value = payload;
+
+  current = client;
+  while(client->sent < ctx.messages && client->sent - client->received < ctx.window
+    && client->out_len + payload_len + client->topic_len + 16 <= sizeof(client->out)) {
+    clv_t output = { .capacity=sizeof(client->out) - client->out_len, .value=client->out + client->out_len };
+
+    sent_ns = now_ns();
+    memcpy( payload, &sent_ns, sizeof(sent_ns) );
+    if(ctx.rate) {
+      rc = client_publish_limited( client, &params, (uint32_t) (sent_ns / 1000000) );
+    }
+    else if(MQTT_SUCCESS == (rc = mqtt_track_publish( &client->track, &client->cli, &params, &output, cb_track, client, NULL ))) {
+      client->out_len += output.length;
+    }
+    if(rc == MQTT_NO_PKT_ID || rc == MQTT_THROTTLED) {
+      break;
+    }
+    else if(rc != MQTT_SUCCESS) {
+      return rc;
+    }
+    ++client->sent;
+  }
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Sends as much outgoing data as possible without blocking.
+ * @param client Client to use
+ * @return Returns 0 on success, otherwise -1
+ */
+static int client_flush(loopback_client_t *client) {
+  ssize_t sent;
+
+  while(client->out_len) {
+    if( -1 == (sent = send( client->sock, client->out, client->out_len, MSG_NOSIGNAL )) ) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    memmove( client->out, client->out + sent, client->out_len - sent );
+    client->out_len -= sent;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Connects the client to the broker and prepares CONNECT packet.
+ * @param client Client to initialize
+ * @param idx Index of the client
+ * @param port Broker's port
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t client_open(loopback_client_t *client, long idx, uint16_t port) {
+  struct sockaddr_in addr;
+  mqtt_params_t params = { .bufsize=LOOPBACK_BUFSIZE, .max_pkt_id=LOOPBACK_MAX_PKT_ID, .timeout=1, .version=ctx.mqtt_version };
+  char id[MAX_USERID_LEN];
+  lv_t userid = { .value=(uint8_t*) id };
+  int flag = 1;
+  uint16_t rc;
+
+  client->topic_len = snprintf( client->topic, sizeof(client->topic), "bench/%ld", idx );
+  memset( &addr, 0x00, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = htonl( INADDR_LOOPBACK );
+  addr.sin_port = htons( port );
+  if( -1 == (client->sock = socket( AF_INET, SOCK_STREAM, 0 ))
+    || 0 != connect( client->sock, (struct sockaddr*) &addr, sizeof(addr) ) ) {
+    return MQTT_NOT_CONNECTED;
+  }
+  setsockopt( client->sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag) );
+  fcntl( client->sock, F_SETFL, fcntl( client->sock, F_GETFL, 0 ) | O_NONBLOCK );
+
+  if( MQTT_SUCCESS != (rc = mqtt_cli_init_ex( &client->cli, &params )) ) {
+    return rc;
+  }
+  client->cli.set_cb_connack( &client->cli, cb_connack );
+  client->cli.set_cb_suback( &client->cli, cb_suback );
+  client->cli.set_cb_publish( &client->cli, cb_publish );
+  client->cli.set_cb_puback( &client->cli, cb_puback );
+  mqtt_track_init( &client->track, client->slots, LOOPBACK_MAX_PKT_ID );
+  /* Messages are spread evenly, no burst is allowed */
+  mqtt_ratelimit_init( &client->limit, ctx.rate, 1, 0, 0, (uint32_t) (now_ns() / 1000000) );
+  userid.length = snprintf( id, sizeof(id), "loopback%ld", idx );
+  if( MQTT_SUCCESS != (rc = client->cli.set_br_userid( &client->cli, &userid )) ) {
+    return rc;
+  }
+
+  /* CONNECT */
+  return client_process( client, 0 );
+}
+
+/**
+ * @brief Sends DISCONNECT and releases the client.
+ * @param client Client to close
+ */
+static void client_close(loopback_client_t *client) {
+  if(client->sock >= 0) {
+    client->cli.disconnect( &client->cli );
+    client_process( client, 0 );
+    client_flush( client );
+    close( client->sock );
+  }
+  mqtt_track_fail( &client->track, MQTT_NOT_CONNECTED );
+  mqtt_cli_destr( &client->cli );
+}
+
+/**
+ * @brief Runs single benchmark case and prints the results.
+ * @param port Broker's port
+ * @param qos QoS used to publish and subscribe
+ * @param payload_len Payload length
+ * @return Returns RESULT_OK on success, otherwise RESULT_FAILURE
+ */
+static int run(uint16_t port, uint8_t qos, size_t payload_len) {
+  static uint8_t payload[MAX_MESSAGE_LEN];
+  loopback_client_t *clients;
+  struct pollfd *fds;
+  uint64_t start_ns = 0, end_ns, tick_ns, total;
+  ssize_t length;
+  long i, done, completed = 0, failed = 0, throttled = 0, rethrottled = 0;
+  int timeout;
+  uint32_t now_ms;
+  int result = RESULT_FAILURE;
+  uint16_t rc = MQTT_SUCCESS;
+  double elapsed_s;
+
+  total = (uint64_t) ctx.clients * ctx.messages;
+  clients = calloc( ctx.clients, sizeof(loopback_client_t) );
+  fds = calloc( ctx.clients, sizeof(struct pollfd) );
+  latencies = calloc( total, sizeof(uint64_t) );
+  if(NULL == clients || NULL == fds || NULL == latencies) {
+    fprintf( stderr, "Out of memory\n" );
+    goto finish;
+  }
+  for(i=0; i<ctx.clients; ++i) {
+    clients[i].sock = -1;
+  }
+  memset( payload, 0xA5, sizeof(payload) );
+  latencies_len = 0;
+  run_qos = qos;
+
+  for(i=0; i<ctx.clients; ++i) {
+    if( MQTT_SUCCESS != (rc = client_open( &clients[i], i, port )) ) {
+      fprintf( stderr, "Unable to connect client %ld: 0x%04X\n", i, rc );
+      goto finish;
+    }
+  }
+
+  tick_ns = last_rx_ns = now_ns();
+  do {
+    done = 0;
+    timeout = 100;
+    for(i=0; i<ctx.clients; ++i) {
+      if(clients[i].subscribed) {
+        if(0 == start_ns) {
+          start_ns = now_ns();
+        }
+        if( MQTT_SUCCESS != (rc = client_publish( &clients[i], payload, payload_len )) ) {
+          fprintf( stderr, "Publishing failed: 0x%04X\n", rc );
+          goto finish;
+        }
+      }
+      if(0 != client_flush( &clients[i] )) {
+        fprintf( stderr, "Sending failed\n" );
+        goto finish;
+      }
+      fds[i].fd = clients[i].sock;
+      fds[i].events = POLLIN | (clients[i].out_len ? POLLOUT : 0);
+      done += (clients[i].received >= ctx.messages && !clients[i].track.pending);
+      /* Throttled client is woken up once the rate limiter allows the next message */
+      now_ms = (uint32_t) (now_ns() / 1000000);
+      if(clients[i].waiting && (int32_t) (clients[i].resume_ms - now_ms) < timeout) {
+        timeout = ((int32_t) (clients[i].resume_ms - now_ms) > 0) ? (int) (clients[i].resume_ms - now_ms) : 0;
+      }
+    }
+    if(done == ctx.clients) {
+      break;
+    }
+
+    if(0 < poll( fds, ctx.clients, timeout )) {
+      for(i=0; i<ctx.clients; ++i) {
+        if( !(fds[i].revents & (POLLIN | POLLERR | POLLHUP)) ) {
+          continue;
+        }
+        length = recv( clients[i].sock, clients[i].in + clients[i].in_len, sizeof(clients[i].in) - clients[i].in_len, 0 );
+        if(0 == length || (-1 == length && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          fprintf( stderr, "Connection closed by the broker\n" );
+          goto finish;
+        }
+        if(length > 0) {
+          clients[i].in_len += length;
+          if( MQTT_SUCCESS != (rc = client_receive( &clients[i] )) ) {
+            fprintf( stderr, "Processing failed: 0x%04X\n", rc );
+            goto finish;
+          }
+        }
+      }
+    }
+
+    /* Keep alive handling */
+    end_ns = now_ns();
+    if(end_ns - tick_ns >= 1000000000ULL) {
+      tick_ns = end_ns;
+      for(i=0; i<ctx.clients; ++i) {
+        client_process( &clients[i], 0 );
+      }
+    }
+    if(end_ns - last_rx_ns >= LOOPBACK_TIMEOUT * 1000000000ULL) {
+      fprintf( stderr, "No messages received within %d seconds\n", LOOPBACK_TIMEOUT );
+      goto finish;
+    }
+  } while( 1 );
+  end_ns = last_rx_ns;
+
+  for(i=0; i<ctx.clients; ++i) {
+    completed += clients[i].completed;
+    failed += clients[i].failed;
+    throttled += clients[i].throttled;
+    rethrottled += clients[i].rethrottled;
+  }
+  qsort( latencies, latencies_len, sizeof(uint64_t), compare_u64 );
+  elapsed_s = (double) (end_ns - start_ns) / 1e9;
+  printf("%u,%u,%zu,%ld,%zu,%.0f,%.2f,%.1f,%.1f,%.1f,%ld,%ld,%ld,%ld\n",
+    ctx.mqtt_version, qos, payload_len, ctx.clients, latencies_len,
+    (double) latencies_len / elapsed_s,
+    (double) latencies_len * payload_len / elapsed_s / 1e6,
+    latencies[latencies_len * 50 / 100] / 1e3,
+    latencies[latencies_len * 99 / 100] / 1e3,
+    latencies[latencies_len * 999 / 1000] / 1e3,
+    completed, failed, throttled, rethrottled);
+  result = RESULT_OK;
+
+finish:
+  if(clients) {
+    for(i=0; i<ctx.clients; ++i) {
+      client_close( &clients[i] );
+    }
+  }
+  free( clients );
+  free( fds );
+  free( latencies );
+  latencies = NULL;
+
+  return result;
+}
+
+int main(int argc, char** argv) {
+  broker_t *broker = NULL;
+  uint16_t port;
+  size_t i, j;
+  int result;
+
+  if( RESULT_OK != (result = validate_args( argc, argv )) ) {
+    usage( PROGRAM_NAME );
+    return result;
+  }
+
+  if(0 != broker_start( &broker, &port )) {
+    fprintf( stderr, "Unable to start the broker\n" );
+    return RESULT_FAILURE;
+  }
+
+  printf("version,qos,payload_len,clients,messages,msgs_per_s,mb_per_s,p50_us,p99_us,p999_us,completed,failed,throttled,rethrottled\n");
+  for(i=0; i<sizeof(QOS_LEVELS)/sizeof(QOS_LEVELS[0]) && result == RESULT_OK; ++i) {
+    for(j=0; j<sizeof(PAYLOAD_LENS)/sizeof(PAYLOAD_LENS[0]) && result == RESULT_OK; ++j) {
+      result = run( port, QOS_LEVELS[i], PAYLOAD_LENS[j] );
+    }
+  }
+
+  broker_stop( broker );
+
+  return result;
+}
@@ -0,0 +1,116 @@
+#ifndef __LOOPBACK_H__
+#define __LOOPBACK_H__
+
+#include "../../api/mqtt_cli.h"
+#include "../../api/mqtt_ratelimit.h"
+#include "../../api/mqtt_track.h"
+
+/** Program name */
+#define PROGRAM_NAME      "loopback"
+/** Program's author */
+#define PROGRAM_AUTHOR    "Jakub Piwowarczyk"
+/** Program's version*/
+#define PROGRAM_VERSION   "1.0.0.0"
+
+#define RESULT_OK         (int) (0)
+#define RESULT_FAILURE    (int) (65535)
+
+/** Default number of clients */
+#define DEFAULT_CLIENTS     4
+/** Default number of messages published by each client */
+#define DEFAULT_MESSAGES    10000
+/** Default number of messages published by each client and not yet received back */
+#define DEFAULT_WINDOW      16
+/** Default MQTT protocol's version */
+#define DEFAULT_VERSION     5
+/** Internal buffer size used by the clients */
+#define LOOPBACK_BUFSIZE    4096
+/** Maximum number of packet identifiers used by the clients */
+#define LOOPBACK_MAX_PKT_ID 32
+/** Size of the socket buffers of each client */
+#define LOOPBACK_SOCKBUF    (64 * 1024)
+/** Run is aborted when no message is received for the specified number of seconds */
+#define LOOPBACK_TIMEOUT    10
+
+/** Short option: clients */
+#define S_OPT_CLIENTS       'c'
+/** Long option: clients */
+#define L_OPT_CLIENTS       "clients"
+/** Short option: messages */
+#define S_OPT_MESSAGES      'n'
+/** Long option: messages */
+#define L_OPT_MESSAGES      "messages"
+/** Short option: window */
+#define S_OPT_WINDOW        'w'
+/** Long option: window */
+#define L_OPT_WINDOW        "window"
+/** Short option: rate */
+#define S_OPT_RATE          'r'
+/** Long option: rate */
+#define L_OPT_RATE          "rate"
+/** Short option: mqtt-version */
+#define S_OPT_MQTT_VERSION  '\3'
+/** Long option: mqtt-version */
+#define L_OPT_MQTT_VERSION  "mqtt-version"
+
+/** @brief Program context definition */
+typedef struct program_ctx {
+  /** Number of clients */
+  long clients;
+  /** Number of messages published by each client */
+  long messages;
+  /** Number of messages in flight per client */
+  long window;
+  /** Messages published per second by each client, 0 if not limited */
+  long rate;
+  /** MQTT protocol's version */
+  uint8_t mqtt_version;
+} context_t;
+
+/** @brief Single benchmarked client */
+typedef struct loopback_client {
+  /** Library client */
+  mqtt_cli_t cli;
+  /** Socket connected to the broker */
+  int sock;
+  /** Topic used to publish and subscribe */
+  char topic[32];
+  /** Topic length */
+  size_t topic_len;
+  /** Set to 1 once SUBACK is received */
+  uint8_t subscribed;
+  /** Number of published messages */
+  long sent;
+  /** Number of received messages */
+  long received;
+  /** Number of messages completed successfully */
+  long completed;
+  /** Number of messages completed with failure */
+  long failed;
+  /** Completion table of the published messages */
+  mqtt_track_t track;
+  /** Slots of the completion table */
+  mqtt_track_slot_t slots[LOOPBACK_MAX_PKT_ID];
+  /** Rate limiter of the published messages */
+  mqtt_ratelimit_t limit;
+  /** Time in milliseconds when the rate limiter allows the next message */
+  uint32_t resume_ms;
+  /** Set to 1 if the last message was throttled */
+  uint8_t waiting;
+  /** Number of throttled messages */
+  long throttled;
+  /** Number of messages throttled again after the reported wait */
+  long rethrottled;
+  /** Received data not processed yet */
+  uint8_t in[LOOPBACK_SOCKBUF];
+  /** Number of bytes in the received data */
+  size_t in_len;
+  /** Data to send */
+  uint8_t out[LOOPBACK_SOCKBUF];
+  /** Number of bytes in the data to send */
+  size_t out_len;
+  /** Buffer passed to the process() function */
+  uint8_t io[LOOPBACK_BUFSIZE];
+} loopback_client_t;
+
+#endif /* __LOOPBACK_H__ */
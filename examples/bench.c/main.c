@@ -0,0 +1,1254 @@
+#define _POSIX_C_SOURCE 200809L
+#include <string.h>
+#include <stdlib.h>
+#include <getopt.h>
+#include <time.h> /* clock_gettime() */
+
+#include "main.h"
+#include "../../api/mqtt_cli.h"
+#include "../../api/mqtt_topic.h"
+#include "../../api/mqtt_rpc.h"
+#include "../../api/mqtt_lvc.h"
+#include "../../api/mqtt_cbor.h"
+#include "../../api/mqtt_framer.h"
+#include "../../api/mqtt_ha.h"
+
+/** Program context */
+static context_t ctx;
+
+/** Number of allocations, incremented by the malloc() wrapper */
+static uint64_t allocs;
+
+/** Library property lookup, captured from the callback context */
+static void (*find_property) (const uint8_t tag, const uint8_t *buf, size_t *offset, size_t *used, size_t *length);
+
+/** Buffer used to stage incoming packets and to receive outgoing ones */
+static uint8_t io_buf[BENCH_BUFSIZE];
+/** Buffer used to store packets prepared manually */
+static uint8_t out_buf[BENCH_BUFSIZE];
+/** Topic used by all cases */
+static uint8_t topic_buf[MAX_TOPIC_LEN];
+/** Payload used by all cases */
+static uint8_t payload_buf[65535];
+/** Properties used by all cases */
+static uint8_t props_buf[MAX_PROPERTIES_LEN];
+
+/** Swept topic lengths */
+static const size_t TOPIC_LENS[] = { 1, 16, 64, 256, 1024 };
+/** Swept payload lengths */
+static const size_t PAYLOAD_LENS[] = { 0, 16, 128, 1024, 16384, 65535 };
+/** Swept number of properties */
+static const size_t PROPS_COUNTS[] = { 0, 1, 4, 16 };
+/** Swept Remaining Length values, encoded using 1 up to 4 bytes */
+static const size_t REMAINING_LENS[] = { 0x7F, 0x3FFF, 0x1FFFFF, 0xFFFFFFF };
+
+static struct option long_options[] = {
+  {L_OPT_ITERATIONS,   required_argument,  0,  S_OPT_ITERATIONS},
+  {L_OPT_MQTT_VERSION, required_argument,  0,  S_OPT_MQTT_VERSION},
+  {NULL,               no_argument,        0,  0}
+};
+
+void *__real_malloc(size_t size);
+
+/**
+ * @brief Counts allocations made by the library and by the program.
+ * @param size Number of bytes to allocate
+ */
+void *__wrap_malloc(size_t size) {
+  ++allocs;
+  return __real_malloc( size );
+}
+
+/**
+ * @brief Parse the command line arguments and set some global flags.
+ * @param argc Number of arguments passed to program
+ * @param argv Values of arguments
+ */
+int validate_args(int argc, char **argv) {
+  int idx, c;
+
+  /* Set default values */
+  memset( &ctx, 0x00, sizeof(context_t) );
+  ctx.iterations = DEFAULT_ITERATIONS;
+
+  while( 1 ) {
+    c = getopt_long( argc, argv,"n:", long_options, &idx );
+    /* Detect the end of the options */
+    if( c == -1) {
+      break;
+    }
+    switch(c) {
+      case S_OPT_ITERATIONS:
+        ctx.iterations = atol( optarg );
+        break;
+      case S_OPT_MQTT_VERSION:
+        ctx.mqtt_version = atoi( optarg );
+        break;
+      case '?':
+        return RESULT_FAILURE;
+      default:
+        exit(1);
+    }
+  }
+
+  if(ctx.iterations <= 0) {
+    return RESULT_FAILURE;
+  }
+
+  if(ctx.mqtt_version != 0 && ctx.mqtt_version != 4 && ctx.mqtt_version != 5) {
+    return RESULT_FAILURE;
+  }
+
+  return RESULT_OK;
+}
+
+/**
+ * @brief Prints available options for the program
+ */
+void usage(const char* program) {
+  printf("NAME\r\n");
+  printf("       %s\r\n", program);
+  printf("SYNOPSIS\r\n");
+  printf("       %s %s", program, "[options]\r\n");
+  printf("OPTIONS\r\n");
+  printf(" -%c count, --%s count\r\n\t%s\r\n",         S_OPT_ITERATIONS,  L_OPT_ITERATIONS,    "Sets the number of iterations of each case.");
+  printf(" --%s version\r\n\t%s\r\n",                  L_OPT_MQTT_VERSION,                     "Sets MQTT protocol's version. If not specified versions 4 and 5 are used.");
+  printf("\r\n");
+}
+
+static uint64_t now_ns(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
+}
+
+/**
+ * @brief Encodes the Variable Byte Integer.
+ * @param buf Buffer used to store encoded value
+ * @param value Value to encode
+ * @return Returns number of bytes used
+ */
+static size_t encode_varint(uint8_t *buf, size_t value) {
+  size_t used = 0;
+
+  do {
+    buf[used] = value & 0x7F;
+    value >>= 7;
+    if(value) {
+      buf[used] |= 0x80;
+    }
+    ++used;
+  } while(value);
+
+  return used;
+}
+
+/**
+ * @brief Prepares the properties: User Properties followed by Payload Format Indicator.
+ * @param buf Buffer used to store the properties
+ * @param count Number of properties
+ * @return Returns number of bytes used
+ */
+static size_t build_props(uint8_t *buf, size_t count) {
+  static const uint8_t USER_PROPERTY[] = { 0x26, 0x00, 0x01, 'k', 0x00, 0x01, 'v' };
+  static const uint8_t PAYLOAD_FORMAT[] = { 0x01, 0x00 };
+  size_t length = 0;
+
+  for(; count > 1; --count) {
+    memcpy( buf + length, USER_PROPERTY, sizeof(USER_PROPERTY) );
+    length += sizeof(USER_PROPERTY);
+  }
+  if(count) {
+    memcpy( buf + length, PAYLOAD_FORMAT, sizeof(PAYLOAD_FORMAT) );
+    length += sizeof(PAYLOAD_FORMAT);
+  }
+
+  return length;
+}
+
+/**
+ * @brief Prepares incoming PUBLISH packet.
+ * @param buf Buffer used to store the packet
+ * @param version MQTT protocol's version
+ * @param qos Quality of Service
+ * @param topic_len Topic length
+ * @param payload_len Payload length
+ * @param props Number of properties
+ * @return Returns packet length
+ */
+static size_t build_incoming_publish(uint8_t *buf, uint8_t version, uint8_t qos, size_t topic_len, size_t payload_len, size_t props) {
+  uint8_t header[8];
+  size_t props_len = 0, remaining, offset = 0, used;
+
+  if(version >= 5) {
+    props_len = build_props( props_buf, props );
+    used = encode_varint( header, props_len );
+  }
+  else {
+    used = 0;
+  }
+
+  remaining = 2 + topic_len + (qos ? 2 : 0) + (version >= 5 ? used + props_len : 0) + payload_len;
+  buf[offset++] = 0x30 | (qos << 1);
+  offset += encode_varint( buf + offset, remaining );
+  buf[offset++] = (uint8_t) (topic_len >> 8);
+  buf[offset++] = (uint8_t) (topic_len);
+  memcpy( buf + offset, topic_buf, topic_len );
+  offset += topic_len;
+  if(qos) {
+    buf[offset++] = 0x00;
+    buf[offset++] = 0x01;
+  }
+  if(version >= 5) {
+    memcpy( buf + offset, header, used );
+    offset += used;
+    memcpy( buf + offset, props_buf, props_len );
+    offset += props_len;
+  }
+  memcpy( buf + offset, payload_buf, payload_len );
+  offset += payload_len;
+
+  return offset;
+}
+
+mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
+  find_property = self->find_property;
+
+  return RC_SUCCESS;
+}
+
+mqtt_rc_t cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, const mqtt_channel_t *channel) {
+  return RC_SUCCESS;
+}
+
+/**
+ * @brief Processes packets until there is no more data to send.
+ * @param cli Client to use
+ * @param data Incoming data, on return the last outgoing data
+ * @param sent Number of bytes prepared to send
+ * @return Returns the last process() return code
+ */
+static uint16_t process_all(mqtt_cli_t *cli, clv_t *data, uint64_t *sent) {
+  uint16_t rc;
+
+  do {
+    rc = cli->process( cli, data, NULL );
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      break;
+    }
+    if(sent) {
+      *sent += data->length;
+    }
+    data->length = 0;
+  } while( rc == MQTT_PENDING_DATA );
+
+  return rc;
+}
+
+/**
+ * @brief Initializes the client and establishes the connection with a simulated broker.
+ * @param cli Client to initialize
+ * @param version MQTT protocol's version
+ * @return Returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t client_open(mqtt_cli_t *cli, uint8_t version) {
+  static const uint8_t CONNACK_V4[] = { 0x20, 0x02, 0x00, 0x00 };
+  static const uint8_t CONNACK_V5[] = { 0x20, 0x03, 0x00, 0x00, 0x00 };
+  static const char USERID[] = "benchclient";
+  uint16_t rc;
+  uint8_t connected = 0;
+  mqtt_params_t params = { .bufsize=BENCH_BUFSIZE, .max_pkt_id=BENCH_MAX_PKT_ID, .timeout=1, .version=version };
+  lv_t userid = { .length=sizeof(USERID)-1, .value=(uint8_t*) USERID };
+  clv_t data = { .capacity=sizeof(io_buf), .value=io_buf };
+
+  memset( cli, 0x00, sizeof(mqtt_cli_t) );
+  if( MQTT_SUCCESS != (rc = mqtt_cli_init_ex( cli, &params )) ) {
+    return rc;
+  }
+  cli->set_cb_connack( cli, cb_connack );
+  cli->set_cb_publish( cli, cb_publish );
+  cli->set_br_keepalive( cli, (uint16_t) 0xFFFF );
+  if( MQTT_SUCCESS != (rc = cli->set_br_userid( cli, &userid )) ) {
+    return rc;
+  }
+
+  /* CONNECT */
+  if( MQTT_SUCCESS != (rc = process_all( cli, &data, NULL )) ) {
+    return rc;
+  }
+
+  /* CONNACK */
+  if(version >= 5) {
+    memcpy( io_buf, CONNACK_V5, sizeof(CONNACK_V5) );
+    data.length = sizeof(CONNACK_V5);
+  }
+  else {
+    memcpy( io_buf, CONNACK_V4, sizeof(CONNACK_V4) );
+    data.length = sizeof(CONNACK_V4);
+  }
+  if( MQTT_SUCCESS != (rc = process_all( cli, &data, NULL )) ) {
+    return rc;
+  }
+
+  cli->is_connected( cli, &connected );
+
+  return connected ? MQTT_SUCCESS : MQTT_NOT_CONNECTED;
+}
+
+/**
+ * @brief Prints the header of the results.
+ */
+static void bench_header(void) {
+  printf("group,op,version,topic_len,payload_len,props,iterations,ns_per_op,bytes_per_s,allocs_per_op,rc\n");
+}
+
+/**
+ * @brief Prints single result row.
+ * @param r Result to print
+ */
+static void bench_emit(const bench_result_t *r) {
+  double ns_per_op = 0, bytes_per_s = 0, allocs_per_op = 0;
+
+  if(r->iterations > 0) {
+    ns_per_op = (double) r->elapsed_ns / (double) r->iterations;
+    allocs_per_op = (double) r->allocs / (double) r->iterations;
+  }
+  if(r->elapsed_ns > 0) {
+    bytes_per_s = (double) r->bytes * 1e9 / (double) r->elapsed_ns;
+  }
+
+  printf("%s,%s,%u,%zu,%zu,%zu,%ld,%.1f,%.0f,%.3f,0x%04X\n", r->group, r->op, r->version, r->topic_len, r->payload_len, r->props,
+    r->iterations, ns_per_op, bytes_per_s, allocs_per_op, r->rc);
+  fflush( stdout );
+}
+
+/**
+ * @brief Benchmarks decoding of the Remaining Length (get_pkt_length).
+ */
+static void bench_decode_size(mqtt_cli_t *cli, uint8_t version) {
+  bench_result_t r;
+  uint8_t header[5];
+  size_t i, length;
+  long n;
+  lv_t packet;
+  uint64_t start;
+
+  for(i=0; i<sizeof(REMAINING_LENS)/sizeof(REMAINING_LENS[0]); ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "codec";
+    r.op = "decode_size";
+    r.version = version;
+    r.payload_len = REMAINING_LENS[i];
+    r.rc = MQTT_SUCCESS;
+    header[0] = 0x30;
+    packet.length = 1 + encode_varint( header + 1, REMAINING_LENS[i] );
+    packet.value = header;
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations; ++n) {
+      length = 0;
+      cli->get_pkt_length( cli, &packet, &length );
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.bytes = (uint64_t) n * packet.length;
+    if(length != packet.length + REMAINING_LENS[i]) {
+      r.rc = MQTT_MALFORMED_PACKET;
+    }
+    bench_emit( &r );
+  }
+}
+
+/**
+ * @brief Benchmarks finding the end of the packet received in chunks of BENCH_FRAME_CHUNK bytes: get_pkt_length of all
+ *        bytes received so far after each read, as the examples used to do, and mqtt_framer_feed resuming the decoding.
+ */
+static void bench_frame(mqtt_cli_t *cli, uint8_t version) {
+  static const char *OPS[] = { "frame_rescan", "frame_resume" };
+  bench_result_t r;
+  mqtt_framer_t framer;
+  size_t i, received, length, total;
+  long n;
+  lv_t packet;
+  uint64_t start;
+
+  out_buf[0] = 0x30;
+  total = 1 + encode_varint( out_buf + 1, 4096 ) + 4096;
+  memset( out_buf + total - 4096, 'p', 4096 );
+  mqtt_framer_init( &framer, sizeof(out_buf) );
+
+  for(i=0; i<sizeof(OPS)/sizeof(OPS[0]); ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "codec";
+    r.op = OPS[i];
+    r.version = version;
+    r.payload_len = total;
+    r.rc = MQTT_SUCCESS;
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations && r.rc == MQTT_SUCCESS; ++n) {
+      length = 0;
+      for(received=BENCH_FRAME_CHUNK; ; received+=BENCH_FRAME_CHUNK) {
+        if(received > total) {
+          received = total;
+        }
+        if(0 == i) {
+          packet.length = received;
+          packet.value = out_buf;
+          cli->get_pkt_length( cli, &packet, &length );
+          if(received >= length) {
+            break;
+          }
+        } else if(MQTT_PENDING_DATA != (r.rc = mqtt_framer_feed( &framer, out_buf, received, &length ))) {
+          break;
+        }
+      }
+      if(length != total) {
+        r.rc = MQTT_MALFORMED_PACKET;
+      }
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.bytes = (uint64_t) n * total;
+    bench_emit( &r );
+  }
+}
+
+/**
+ * @brief Benchmarks PUBLISH packet creation (publish_ex).
+ */
+static void bench_build_publish_case(mqtt_cli_t *cli, uint8_t version, size_t topic_len, size_t payload_len, size_t props) {
+  bench_result_t r;
+  mqtt_publish_params_t params = { };
+  clv_t output = { .capacity=sizeof(out_buf), .value=out_buf };
+  long n;
+  uint64_t start;
+
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "codec";
+  r.op = "build_publish";
+  r.version = version;
+  r.topic_len = topic_len;
+  r.payload_len = payload_len;
+  r.props = props;
+
+  params.topic = (lv_t) { .length=topic_len, .value=topic_buf };
+  params.message = (lv_t) { .length=payload_len, .value=payload_buf };
+  params.properties.length = build_props( props_buf, props );
+  params.properties.value = params.properties.length ? props_buf : NULL;
+
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    output.length = 0;
+    if( MQTT_SUCCESS != (r.rc = cli->publish_ex( cli, &params, &output )) ) {
+      break;
+    }
+    r.bytes += output.length;
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  bench_emit( &r );
+}
+
+static void bench_build_publish(mqtt_cli_t *cli, uint8_t version) {
+  size_t i;
+
+  for(i=0; i<sizeof(TOPIC_LENS)/sizeof(TOPIC_LENS[0]); ++i) {
+    bench_build_publish_case( cli, version, TOPIC_LENS[i], 16, 0 );
+  }
+  for(i=0; i<sizeof(PAYLOAD_LENS)/sizeof(PAYLOAD_LENS[0]); ++i) {
+    bench_build_publish_case( cli, version, 16, PAYLOAD_LENS[i], 0 );
+  }
+  for(i=1; version >= 5 && i<sizeof(PROPS_COUNTS)/sizeof(PROPS_COUNTS[0]); ++i) {
+    bench_build_publish_case( cli, version, 16, 16, PROPS_COUNTS[i] );
+  }
+}
+
+/**
+ * @brief Acknowledges all SUBSCRIBE packets prepared in the out_buf.
+ * @param ids Packet identifiers to acknowledge
+ * @param count Number of packet identifiers
+ */
+static uint16_t ack_packets(mqtt_cli_t *cli, uint8_t version, uint8_t type, const uint16_t *ids, size_t count) {
+  uint16_t rc = MQTT_SUCCESS;
+  clv_t data = { .capacity=sizeof(io_buf), .value=io_buf };
+  size_t i;
+
+  for(i=0; i<count; ++i) {
+    data.length = 0;
+    io_buf[data.length++] = type;
+    io_buf[data.length++] = (type == 0x90) ? (version >= 5 ? 4 : 3) : 2;
+    io_buf[data.length++] = (uint8_t) (ids[i] >> 8);
+    io_buf[data.length++] = (uint8_t) (ids[i]);
+    if(type == 0x90) {
+      if(version >= 5) {
+        io_buf[data.length++] = 0x00;
+      }
+      io_buf[data.length++] = 0x00;
+    }
+    if( MQTT_SUCCESS != (rc = process_all( cli, &data, NULL )) ) {
+      break;
+    }
+  }
+
+  return rc;
+}
+
+/**
+ * @brief Benchmarks SUBSCRIBE packet creation (subscribe_ex).
+ * @note Each packet reserves the Packet Identifier, therefore packets are prepared in batches acknowledged outside the measurement.
+ */
+static void bench_build_subscribe_case(mqtt_cli_t *cli, uint8_t version, size_t topic_len, size_t props) {
+  bench_result_t r;
+  mqtt_subscribe_params_t params = { };
+  clv_t output = { .capacity=sizeof(out_buf), .value=out_buf };
+  uint16_t ids[BENCH_MAX_PKT_ID];
+  size_t batch, fixed;
+  long n;
+  uint64_t start;
+
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "codec";
+  r.op = "build_subscribe";
+  r.version = version;
+  r.topic_len = topic_len;
+  r.props = props;
+  r.rc = MQTT_SUCCESS;
+
+  params.filter = (mqtt_subscribe_filter_t) { .length=topic_len, .options=1, .value=topic_buf };
+  params.properties.length = build_props( props_buf, props );
+  params.properties.value = params.properties.length ? props_buf : NULL;
+
+  for(n=0; n<ctx.iterations && r.rc == MQTT_SUCCESS; ) {
+    r.allocs -= allocs;
+    start = now_ns();
+    for(batch=0; batch<BENCH_MAX_PKT_ID && n<ctx.iterations; ++batch, ++n) {
+      output.length = 0;
+      if( MQTT_SUCCESS != (r.rc = cli->subscribe_ex( cli, &params, &output )) ) {
+        break;
+      }
+      r.bytes += output.length;
+      /* Packet Identifier follows the fixed header */
+      for(fixed=1; output.value[fixed] & 0x80; ++fixed) {}
+      ids[batch] = (uint16_t) (output.value[fixed+1] << 8) | output.value[fixed+2];
+    }
+    r.elapsed_ns += now_ns() - start;
+    r.allocs += allocs;
+    if(r.rc == MQTT_SUCCESS) {
+      r.rc = ack_packets( cli, version, 0x90, ids, batch );
+    }
+  }
+  r.iterations = n;
+  bench_emit( &r );
+}
+
+static void bench_build_subscribe(mqtt_cli_t *cli, uint8_t version) {
+  size_t i;
+
+  for(i=0; i<sizeof(TOPIC_LENS)/sizeof(TOPIC_LENS[0]); ++i) {
+    bench_build_subscribe_case( cli, version, TOPIC_LENS[i], 0 );
+  }
+  for(i=1; version >= 5 && i<sizeof(PROPS_COUNTS)/sizeof(PROPS_COUNTS[0]); ++i) {
+    bench_build_subscribe_case( cli, version, 16, PROPS_COUNTS[i] );
+  }
+}
+
+/**
+ * @brief Benchmarks processing of incoming PUBLISH packet.
+ * @note Each iteration includes copying the packet to the process() buffer, because the buffer is also used for outgoing data.
+ */
+static void bench_parse_publish_case(mqtt_cli_t *cli, uint8_t version, size_t topic_len, size_t payload_len, size_t props) {
+  bench_result_t r;
+  clv_t data = { .capacity=sizeof(io_buf), .value=io_buf };
+  size_t length;
+  long n;
+  uint64_t start;
+
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "codec";
+  r.op = "parse_publish";
+  r.version = version;
+  r.topic_len = topic_len;
+  r.payload_len = payload_len;
+  r.props = props;
+
+  if(payload_len > sizeof(out_buf) - MAX_TOPIC_LEN - MAX_PROPERTIES_LEN - 16) {
+    r.rc = MQTT_OUT_OF_MEM;
+    bench_emit( &r );
+    return;
+  }
+  length = build_incoming_publish( out_buf, version, 0, topic_len, payload_len, props );
+
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    memcpy( io_buf, out_buf, length );
+    data.length = length;
+    if( MQTT_SUCCESS != (r.rc = process_all( cli, &data, NULL )) ) {
+      break;
+    }
+    r.bytes += length;
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  bench_emit( &r );
+}
+
+static void bench_parse_publish(mqtt_cli_t *cli, uint8_t version) {
+  size_t i;
+
+  for(i=0; i<sizeof(TOPIC_LENS)/sizeof(TOPIC_LENS[0]); ++i) {
+    bench_parse_publish_case( cli, version, TOPIC_LENS[i], 16, 0 );
+  }
+  for(i=0; i<sizeof(PAYLOAD_LENS)/sizeof(PAYLOAD_LENS[0]); ++i) {
+    bench_parse_publish_case( cli, version, 16, PAYLOAD_LENS[i], 0 );
+  }
+  for(i=1; version >= 5 && i<sizeof(PROPS_COUNTS)/sizeof(PROPS_COUNTS[0]); ++i) {
+    bench_parse_publish_case( cli, version, 16, 16, PROPS_COUNTS[i] );
+  }
+}
+
+/**
+ * @brief Benchmarks processing of incoming PUBACK packet.
+ * @note QoS 1 PUBLISH packets are prepared in batches outside the measurement.
+ */
+static void bench_parse_puback(mqtt_cli_t *cli, uint8_t version) {
+  bench_result_t r;
+  mqtt_publish_params_t params = { };
+  clv_t output = { .capacity=sizeof(out_buf), .value=out_buf };
+  clv_t data = { .capacity=sizeof(io_buf), .value=io_buf };
+  uint16_t ids[BENCH_MAX_PKT_ID];
+  size_t batch, count, offset;
+  long n;
+  uint64_t start;
+
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "codec";
+  r.op = "parse_puback";
+  r.version = version;
+  r.topic_len = 16;
+  r.rc = MQTT_SUCCESS;
+
+  params.flags = 0x02;
+  params.topic = (lv_t) { .length=16, .value=topic_buf };
+
+  for(n=0; n<ctx.iterations && r.rc == MQTT_SUCCESS; ) {
+    for(count=0; count<BENCH_MAX_PKT_ID && n+(long) count<ctx.iterations; ++count) {
+      output.length = 0;
+      if( MQTT_SUCCESS != (r.rc = cli->publish_ex( cli, &params, &output )) ) {
+        break;
+      }
+      /* Packet Identifier follows the Topic Name */
+      for(offset=1; output.value[offset] & 0x80; ++offset) {}
+      offset += 3 + params.topic.length;
+      ids[count] = (uint16_t) (output.value[offset] << 8) | output.value[offset+1];
+    }
+
+    r.allocs -= allocs;
+    start = now_ns();
+    for(batch=0; batch<count; ++batch, ++n) {
+      io_buf[0] = 0x40;
+      io_buf[1] = 0x02;
+      io_buf[2] = (uint8_t) (ids[batch] >> 8);
+      io_buf[3] = (uint8_t) (ids[batch]);
+      data.length = 4;
+      if( MQTT_SUCCESS != (r.rc = process_all( cli, &data, NULL )) ) {
+        break;
+      }
+      r.bytes += 4;
+    }
+    r.elapsed_ns += now_ns() - start;
+    r.allocs += allocs;
+  }
+  r.iterations = n;
+  bench_emit( &r );
+}
+
+/**
+ * @brief Benchmarks lookup of the last property (find_property).
+ */
+static void bench_find_property(uint8_t version) {
+  bench_result_t r;
+  size_t i, offset, used, length, props_len;
+  long n;
+  uint64_t start;
+
+  for(i=1; version >= 5 && find_property && i<sizeof(PROPS_COUNTS)/sizeof(PROPS_COUNTS[0]); ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "codec";
+    r.op = "find_property";
+    r.version = version;
+    r.props = PROPS_COUNTS[i];
+    r.rc = MQTT_SUCCESS;
+    props_len = build_props( props_buf, PROPS_COUNTS[i] );
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations; ++n) {
+      length = props_len;
+      find_property( 0x01, props_buf, &offset, &used, &length );
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.bytes = (uint64_t) n * props_len;
+    if(length != 1) {
+      r.rc = MQTT_MALFORMED_PACKET;
+    }
+    bench_emit( &r );
+  }
+}
+
+/**
+ * @brief Completion callback of the rpc case, counts the responses.
+ */
+static void bench_rpc_done(void *arg, const mqtt_publish_t *pkt) {
+  if(NULL != pkt) {
+    ++*(long*) arg;
+  }
+}
+
+/**
+ * @brief Benchmarks the request allocation (mqtt_rpc_prepare) and response correlation (mqtt_rpc_response)
+ *        with BENCH_RPC_PENDING requests pending.
+ */
+static void bench_rpc(uint8_t version) {
+  static mqtt_rpc_slot_t slots[BENCH_RPC_PENDING];
+  static const char RESPONSE_TOPIC[] = "reply/bench";
+  bench_result_t r;
+  mqtt_rpc_t rpc;
+  mqtt_cli_ctx_cb_t self;
+  mqtt_publish_params_t params = { };
+  mqtt_publish_t response = { };
+  lv_t response_topic = { .length=sizeof(RESPONSE_TOPIC)-1, .value=(uint8_t*) RESPONSE_TOPIC };
+  long n, completed = 0;
+  uint64_t start;
+
+  if(version < 5 || !find_property) {
+    return;
+  }
+
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "rpc";
+  r.op = "request_response";
+  r.version = version;
+  r.props = 2;
+  r.rc = MQTT_SUCCESS;
+  memset( &self, 0x00, sizeof(self) );
+  self.find_property = find_property;
+  mqtt_rpc_init( &rpc, slots, BENCH_RPC_PENDING, &response_topic, 60 );
+
+  /* Keeping the table almost full, so the found slot is never the first one */
+  while(rpc.pending < BENCH_RPC_PENDING - 1) {
+    params.properties = (lv_t) { .length=0, .value=NULL };
+    mqtt_rpc_prepare( &rpc, &params, props_buf, sizeof(props_buf), bench_rpc_done, &completed, 0, NULL );
+  }
+
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    params.properties = (lv_t) { .length=0, .value=NULL };
+    if(MQTT_SUCCESS != (r.rc = mqtt_rpc_prepare( &rpc, &params, props_buf, sizeof(props_buf), bench_rpc_done, &completed, 0, NULL ))) {
+      break;
+    }
+    response.properties = params.properties;
+    mqtt_rpc_response( &rpc, &self, &response );
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  if(completed != n) {
+    r.rc = MQTT_MALFORMED_PACKET;
+  }
+  bench_emit( &r );
+}
+
+/**
+ * @brief Benchmarks the last value cache: mqtt_lvc_update cycling through BENCH_LVC_TOPICS topics, so every second
+ *        update evicts an entry, and mqtt_lvc_get of the cached topics.
+ */
+static void bench_lvc(void) {
+  static mqtt_lvc_slot_t slots[BENCH_LVC_SLOTS];
+  static uint8_t buf[BENCH_LVC_SLOTS * 64];
+  static char values[BENCH_LVC_TOPICS][32];
+  static size_t lengths[BENCH_LVC_TOPICS];
+  bench_result_t r;
+  mqtt_lvc_t lvc;
+  mqtt_publish_t pkt = { };
+  lv_t topic, message;
+  size_t i, found = 0;
+  long n;
+  uint64_t start;
+
+  for(i=0; i<BENCH_LVC_TOPICS; ++i) {
+    lengths[i] = sprintf( values[i], "site/%zu/dev/temp", i );
+  }
+  mqtt_lvc_init( &lvc, slots, BENCH_LVC_SLOTS, buf, 64 );
+  pkt.message = (lv_t) { .length=16, .value=payload_buf };
+
+  for(i=0; i<2; ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "lvc";
+    r.op = (i == 0) ? "update" : "get";
+    r.topic_len = lengths[0];
+    r.payload_len = pkt.message.length;
+    r.rc = MQTT_SUCCESS;
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations; ++n) {
+      if(i == 0) {
+        pkt.topic = (lv_t) { .length=lengths[n % BENCH_LVC_TOPICS], .value=(uint8_t*) values[n % BENCH_LVC_TOPICS] };
+        if(MQTT_SUCCESS != (r.rc = mqtt_lvc_update( &lvc, &pkt ))) {
+          break;
+        }
+      }
+      else {
+        topic = (lv_t) { .length=lengths[n % lvc.capacity], .value=(uint8_t*) values[n % lvc.capacity] };
+        found += mqtt_lvc_get( &lvc, &topic, &message );
+      }
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.bytes = (uint64_t) n * (lengths[0] + pkt.message.length);
+    if(i == 1 && found != (size_t) n) {
+      r.rc = MQTT_INVALID_ARGS;
+    }
+    bench_emit( &r );
+
+    /* The cache is filled again without evictions, all its topics are looked up by the get case */
+    mqtt_lvc_init( &lvc, slots, BENCH_LVC_SLOTS, buf, 64 );
+    for(n=0; i == 0 && n<(long) lvc.capacity; ++n) {
+      pkt.topic = (lv_t) { .length=lengths[n], .value=(uint8_t*) values[n] };
+      mqtt_lvc_update( &lvc, &pkt );
+    }
+  }
+}
+
+/**
+ * @brief Benchmarks encoding of the sensor record with sprintf (JSON), the streaming CBOR encoder and the fixed-shape
+ *        CBOR record, followed by decoding of the CBOR record.
+ */
+static void bench_payload(void) {
+  static const char *KEYS[] = { "temp", "hum", "pres", "batt" };
+  static const char *OPS[] = { "sprintf_json", "cbor_stream", "cbor_record", "cbor_decode" };
+  bench_result_t r;
+  mqtt_cbor_record_t record;
+  mqtt_cbor_reader_t reader;
+  mqtt_cbor_item_t item;
+  uint8_t record_buf[64];
+  lv_t keys[4];
+  float values[4] = { 21.5f, 40.25f, 1013.25f, 3.3f };
+  double sum = 0.0;
+  size_t i, k, length = 0;
+  long n;
+  uint64_t start;
+
+  for(k=0; k<4; ++k) {
+    keys[k] = (lv_t) { .length=strlen( KEYS[k] ), .value=(uint8_t*) KEYS[k] };
+  }
+  mqtt_cbor_record_init( &record, record_buf, sizeof(record_buf), keys, 4 );
+
+  for(i=0; i<sizeof(OPS)/sizeof(OPS[0]); ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "payload";
+    r.op = OPS[i];
+    r.props = 4;
+    r.rc = MQTT_SUCCESS;
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations && r.rc == MQTT_SUCCESS; ++n) {
+      clv_t out = { .capacity=sizeof(out_buf), .length=0, .value=out_buf };
+
+      values[0] += 0.25f;
+      switch(i) {
+        case 0:
+          out.length = sprintf( (char*) out_buf, "{\"temp\":%.2f,\"hum\":%.2f,\"pres\":%.2f,\"batt\":%.2f}",
+            values[0], values[1], values[2], values[3] );
+          break;
+        case 1:
+          r.rc = mqtt_cbor_put_map( &out, 4 );
+          for(k=0; k<4 && r.rc == MQTT_SUCCESS; ++k) {
+            if(MQTT_SUCCESS == (r.rc = mqtt_cbor_put_text( &out, KEYS[k], keys[k].length ))) {
+              r.rc = mqtt_cbor_put_float( &out, values[k] );
+            }
+          }
+          break;
+        case 2:
+          r.rc = mqtt_cbor_record_put( &record, &out, values );
+          break;
+        default:
+          /* The record encoded by the previous case is still stored in the buffer */
+          out.length = length;
+          mqtt_cbor_reader_init( &reader, out_buf, out.length );
+          while(MQTT_SUCCESS == mqtt_cbor_read( &reader, &item )) {
+            sum += item.number;
+          }
+          if(reader.offset != out.length) {
+            r.rc = MQTT_MALFORMED_PACKET;
+          }
+          break;
+      }
+      length = out.length;
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.payload_len = length;
+    r.bytes = (uint64_t) n * length;
+    bench_emit( &r );
+  }
+  /* The sum keeps the decoding from being optimized out */
+  if(sum < 0.0) {
+    fprintf( stderr, "%f\n", sum );
+  }
+}
+
+/**
+ * @brief Benchmarks Home Assistant discovery configuration of the switch built with the chained sprintf calls
+ *        (as the examples used to do) and with mqtt_ha_config.
+ */
+static void bench_discovery(void) {
+  static const char *OPS[] = { "sprintf", "ha_config" };
+  static const mqtt_ha_device_t device = {
+    .ids = "ea334450945afc", .name = "acme_dev", .mf = "ACME", .mdl = "xya", .sw = "1.0", .sn = "ea334450945afc", .hw = "1.0rev2"
+  };
+  static const mqtt_ha_origin_t origin = { .name = "mqttcli", .sw = "1.0", .url = "https://innovasoft.org" };
+  static const mqtt_ha_entity_t entity = {
+    .component = MQTT_HA_SWITCH, .base = "homeassistant/switch/hadev123456", .unique_id = "hadev123456",
+    .command_topic = "set", .state_topic = "state", .availability_topic = "available", .payload_on = "ON", .payload_off = "OFF",
+    .payload_available = "online", .payload_not_available = "offline", .state_on = "ON", .state_off = "OFF",
+    .device = &device, .origin = &origin
+  };
+  mqtt_publish_params_t params;
+  bench_result_t r;
+  size_t i, length = 0;
+  char *message;
+  long n;
+  uint64_t start;
+
+  for(i=0; i<sizeof(OPS)/sizeof(OPS[0]); ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "discovery";
+    r.op = OPS[i];
+    r.rc = MQTT_SUCCESS;
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations && r.rc == MQTT_SUCCESS; ++n) {
+      clv_t out = { .capacity=sizeof(out_buf), .length=0, .value=out_buf };
+
+      if(0 == i) {
+        out.length = sprintf( (char*) out_buf, "%s/config", entity.base );
+        message = (char*) out_buf + out.length;
+        message += sprintf( message, "{\"~\":\"%s\",", entity.base );
+        message += sprintf( message, "\"name\":null," );
+        message += sprintf( message, "\"uniq_id\":\"%s\",", entity.unique_id );
+        message += sprintf( message, "\"cmd_t\":\"~/%s\",", entity.command_topic );
+        message += sprintf( message, "\"stat_t\":\"~/%s\",", entity.state_topic );
+        message += sprintf( message, "\"avty_t\":\"~/%s\",", entity.availability_topic );
+        message += sprintf( message, "\"pl_on\":\"%s\",", entity.payload_on );
+        message += sprintf( message, "\"pl_off\":\"%s\",", entity.payload_off );
+        message += sprintf( message, "\"pl_avail\":\"%s\",", entity.payload_available );
+        message += sprintf( message, "\"pl_not_avail\":\"%s\",", entity.payload_not_available );
+        message += sprintf( message, "\"stat_on\":\"%s\",", entity.state_on );
+        message += sprintf( message, "\"stat_off\":\"%s\",", entity.state_off );
+        message += sprintf( message, "\"ret\":false,\"opt\":false," );
+        message += sprintf( message, "\"dev\":{\"ids\":[\"%s\"],\"name\":\"%s\",\"mf\":\"%s\",\"mdl\":\"%s\",\"sw\":\"%s\",\"sn\":\"%s\",\"hw\":\"%s\"},",
+          device.ids, device.name, device.mf, device.mdl, device.sw, device.sn, device.hw );
+        message += sprintf( message, "\"o\":{\"name\":\"%s\",\"sw\":\"%s\",\"url\":\"%s\"}}", origin.name, origin.sw, origin.url );
+        out.length = message - (char*) out_buf;
+      } else {
+        r.rc = mqtt_ha_config( &entity, &out, &params );
+      }
+      length = out.length;
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.payload_len = length;
+    r.bytes = (uint64_t) n * length;
+    bench_emit( &r );
+  }
+}
+
+/**
+ * @brief Reference Topic Name validator checking the topic byte by byte.
+ * @param topic Topic to validate
+ * @return Returns MQTT_SUCCESS if the topic is valid, otherwise MQTT_INVALID_ARGS
+ */
+static uint16_t validate_scalar(const lv_t *topic) {
+  const uint8_t *buf = topic->value;
+  size_t i = 0, n, k;
+  uint8_t c;
+
+  if(topic->length < MIN_TOPIC_LEN || topic->length > MAX_TOPIC_LEN) {
+    return MQTT_INVALID_ARGS;
+  }
+  while(i < topic->length) {
+    c = buf[i];
+    if(c == 0x00 || c == '+' || c == '#') {
+      return MQTT_INVALID_ARGS;
+    }
+    n = (c < 0x80) ? 1 : (c >= 0xC2 && c <= 0xDF) ? 2 : (c >= 0xE0 && c <= 0xEF) ? 3 : (c >= 0xF0 && c <= 0xF4) ? 4 : 0;
+    if(0 == n || i + n > topic->length) {
+      return MQTT_INVALID_ARGS;
+    }
+    if( (c == 0xE0 && buf[i+1] < 0xA0) || (c == 0xED && buf[i+1] > 0x9F) || (c == 0xF0 && buf[i+1] < 0x90) || (c == 0xF4 && buf[i+1] > 0x8F) ) {
+      return MQTT_INVALID_ARGS;
+    }
+    for(k=1; k<n; ++k) {
+      if( (buf[i+k] & 0xC0) != 0x80 ) {
+        return MQTT_INVALID_ARGS;
+      }
+    }
+    i += n;
+  }
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Benchmarks Topic Name validation (mqtt_topic_validate_name) against the byte by byte validator.
+ */
+static void bench_topic_validate(void) {
+  static const uint8_t UTF8_LEVEL[] = { 'l', 'e', 'v', 0xC3, 0xA9, 'l', '/' };
+  static const uint8_t ASCII_LEVEL[] = { 'l', 'e', 'v', 'e', 'l', '/' };
+  /* Operation names per topic content (ASCII, UTF-8) and validator (library, byte by byte) */
+  static const char *OPS[2][2] = { { "validate_ascii", "scalar_ascii" }, { "validate_utf8", "scalar_utf8" } };
+  static uint8_t buf[MAX_TOPIC_LEN];
+  bench_result_t r;
+  size_t i, j, k, level_len;
+  const uint8_t *level;
+  long n;
+  lv_t topic;
+  uint64_t start;
+
+  for(k=0; k<2; ++k) {
+    level = (k == 0) ? ASCII_LEVEL : UTF8_LEVEL;
+    level_len = (k == 0) ? sizeof(ASCII_LEVEL) : sizeof(UTF8_LEVEL);
+    for(i=0; i<sizeof(buf); i+=level_len) {
+      memcpy( buf + i, level, (sizeof(buf) - i < level_len) ? sizeof(buf) - i : level_len );
+    }
+    for(i=0; i<sizeof(TOPIC_LENS)/sizeof(TOPIC_LENS[0]); ++i) {
+      /* Do not split the multibyte character */
+      topic.length = TOPIC_LENS[i];
+      while(topic.length > 1 && (buf[topic.length - 1] & 0xC0) == 0xC0) {
+        --topic.length;
+      }
+      topic.value = buf;
+      for(j=0; j<2; ++j) {
+        memset( &r, 0x00, sizeof(r) );
+        r.group = "topic";
+        r.op = OPS[k][j];
+        r.topic_len = topic.length;
+
+        r.allocs = allocs;
+        start = now_ns();
+        for(n=0; n<ctx.iterations; ++n) {
+          r.rc = (j == 0) ? mqtt_topic_validate_name( &topic ) : validate_scalar( &topic );
+        }
+        r.elapsed_ns = now_ns() - start;
+        r.allocs = allocs - r.allocs;
+        r.iterations = n;
+        r.bytes = (uint64_t) n * topic.length;
+        bench_emit( &r );
+      }
+    }
+  }
+}
+
+/**
+ * @brief Benchmarks matching of the Topic Name against the single compiled filter and against BENCH_TOPIC_FILTERS filters.
+ */
+static void bench_topic_match(void) {
+  static const char TOPIC[] = "site/18/dev17/temp";
+  static const char FILTER[] = "site/+/dev17/temp";
+  static mqtt_topic_filter_t filters[BENCH_TOPIC_FILTERS];
+  static char values[BENCH_TOPIC_FILTERS][32];
+  bench_result_t r;
+  size_t i, found = 0, matches[BENCH_TOPIC_FILTERS];
+  long n;
+  lv_t topic = { .length=sizeof(TOPIC)-1, .value=(uint8_t*) TOPIC };
+  lv_t filter;
+  uint64_t start;
+
+  /* Every second filter uses the multi-level wildcard */
+  for(i=0; i<BENCH_TOPIC_FILTERS; ++i) {
+    filter.length = sprintf( values[i], (i & 1) ? "site/+/dev%zu/#" : "site/%zu/+/temp", i );
+    filter.value = (uint8_t*) values[i];
+    mqtt_topic_compile( &filters[i], &filter );
+  }
+
+  for(i=0; i<2; ++i) {
+    memset( &r, 0x00, sizeof(r) );
+    r.group = "topic";
+    r.op = (i == 0) ? "match" : "match_all";
+    r.topic_len = topic.length;
+    r.rc = MQTT_SUCCESS;
+    if(i == 0) {
+      filter.length = sizeof(FILTER)-1;
+      filter.value = (uint8_t*) FILTER;
+      mqtt_topic_compile( &filters[0], &filter );
+    }
+
+    r.allocs = allocs;
+    start = now_ns();
+    for(n=0; n<ctx.iterations; ++n) {
+      found = (i == 0) ? mqtt_topic_match( &filters[0], &topic )
+        : mqtt_topic_match_all( filters, BENCH_TOPIC_FILTERS, &topic, matches, BENCH_TOPIC_FILTERS );
+    }
+    r.elapsed_ns = now_ns() - start;
+    r.allocs = allocs - r.allocs;
+    r.iterations = n;
+    r.bytes = (uint64_t) n * topic.length;
+    if(found != ((i == 0) ? 1 : 2)) {
+      r.rc = MQTT_INVALID_ARGS;
+    }
+    bench_emit( &r );
+
+    /* Restore the filter used by match_all */
+    filter.length = sprintf( values[0], "site/%zu/+/temp", (size_t) 0 );
+    filter.value = (uint8_t*) values[0];
+    mqtt_topic_compile( &filters[0], &filter );
+  }
+}
+
+/**
+ * @brief Benchmarks the whole process() loop: timeout, outgoing PUBLISH and incoming QoS 1 PUBLISH with PUBACK response.
+ */
+static void bench_process(mqtt_cli_t *cli, uint8_t version) {
+  bench_result_t r;
+  mqtt_publish_params_t params = { };
+  clv_t data = { .capacity=sizeof(io_buf), .value=io_buf };
+  size_t length;
+  long n;
+  uint64_t start;
+
+  /* Timeout */
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "process";
+  r.op = "timeout";
+  r.version = version;
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    data.length = 0;
+    if( MQTT_SUCCESS != (r.rc = process_all( cli, &data, &r.bytes )) ) {
+      break;
+    }
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  bench_emit( &r );
+
+  /* Outgoing QoS 0 PUBLISH */
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "process";
+  r.op = "publish_qos0";
+  r.version = version;
+  r.topic_len = 16;
+  r.payload_len = 128;
+  params.topic = (lv_t) { .length=r.topic_len, .value=topic_buf };
+  params.message = (lv_t) { .length=r.payload_len, .value=payload_buf };
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    if( MQTT_SUCCESS != (r.rc = cli->publish( cli, &params )) ) {
+      break;
+    }
+    data.length = 0;
+    if( MQTT_SUCCESS != (r.rc = process_all( cli, &data, &r.bytes )) ) {
+      break;
+    }
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  bench_emit( &r );
+
+  /* Incoming QoS 1 PUBLISH */
+  memset( &r, 0x00, sizeof(r) );
+  r.group = "process";
+  r.op = "incoming_qos1";
+  r.version = version;
+  r.topic_len = 16;
+  r.payload_len = 128;
+  length = build_incoming_publish( out_buf, version, 1, r.topic_len, r.payload_len, 0 );
+  r.allocs = allocs;
+  start = now_ns();
+  for(n=0; n<ctx.iterations; ++n) {
+    memcpy( io_buf, out_buf, length );
+    data.length = length;
+    r.bytes += length;
+    if( MQTT_SUCCESS != (r.rc = process_all( cli, &data, &r.bytes )) ) {
+      break;
+    }
+  }
+  r.elapsed_ns = now_ns() - start;
+  r.allocs = allocs - r.allocs;
+  r.iterations = n;
+  bench_emit( &r );
+}
+
+int main(int argc, char** argv) {
+  static const uint8_t VERSIONS[] = { 4, 5 };
+  int result = RESULT_OK;
+  size_t i;
+  uint16_t rc;
+  mqtt_cli_t cli;
+
+  /* Validate arguments */
+  if(validate_args(argc, argv)) {
+    usage(argv[0]);
+    return RESULT_FAILURE;
+  }
+
+  memset( topic_buf, 't', sizeof(topic_buf) );
+  memset( payload_buf, 'p', sizeof(payload_buf) );
+
+  bench_header();
+  bench_topic_validate();
+  bench_topic_match();
+  bench_lvc();
+  bench_payload();
+  bench_discovery();
+
+  for(i=0; i<sizeof(VERSIONS)/sizeof(VERSIONS[0]); ++i) {
+    if(ctx.mqtt_version && ctx.mqtt_version != VERSIONS[i]) {
+      continue;
+    }
+    if( MQTT_SUCCESS != (rc = client_open( &cli, VERSIONS[i] )) ) {
+      fprintf(stderr, "client_open( ... ), version = %u, rc = 0x%04X\n", VERSIONS[i], rc);
+      result = RESULT_FAILURE;
+    }
+    else {
+      bench_decode_size( &cli, VERSIONS[i] );
+      bench_frame( &cli, VERSIONS[i] );
+      bench_build_publish( &cli, VERSIONS[i] );
+      bench_build_subscribe( &cli, VERSIONS[i] );
+      bench_parse_publish( &cli, VERSIONS[i] );
+      bench_parse_puback( &cli, VERSIONS[i] );
+      bench_find_property( VERSIONS[i] );
+      bench_rpc( VERSIONS[i] );
+      bench_process( &cli, VERSIONS[i] );
+    }
+    if( NULL != cli.ctx ) {
+      mqtt_cli_destr( &cli );
+    }
+  }
+
+  return result;
+}
@@ -0,0 +1,76 @@
+#ifndef __COMMON_H__
+#define __COMMON_H__
+
+#include "../../api/mqtt_common.h"
+
+/** Program name */
+#define PROGRAM_NAME      "bench"
+/** Program's author */
+#define PROGRAM_AUTHOR    "Jakub Piwowarczyk"
+/** Program's version*/
+#define PROGRAM_VERSION   "1.0.0.0"
+
+#define RESULT_OK         (int) (0)
+#define RESULT_FAILURE    (int) (65535)
+
+/** Default number of iterations of each case */
+#define DEFAULT_ITERATIONS  100000
+/** Internal buffer size used by the benchmarked clients */
+#define BENCH_BUFSIZE       8192
+/** Number of compiled filters matched by the match_all case */
+#define BENCH_TOPIC_FILTERS 256
+/** Number of requests pending in the rpc case */
+#define BENCH_RPC_PENDING   50000
+/** Number of slots of the lvc cases */
+#define BENCH_LVC_SLOTS     4096
+/** Number of distinct topics updated by the lvc update case, twice the cache capacity */
+#define BENCH_LVC_TOPICS    6144
+/** Number of bytes returned by a single read in the frame cases */
+#define BENCH_FRAME_CHUNK   64
+/** Maximum number of packet identifiers used by the benchmarked clients */
+#define BENCH_MAX_PKT_ID    MAX_MAX_PKT_ID
+
+/** Short option: iterations */
+#define S_OPT_ITERATIONS    'n'
+/** Long option: iterations */
+#define L_OPT_ITERATIONS    "iterations"
+/** Short option: mqtt-version */
+#define S_OPT_MQTT_VERSION  '\3'
+/** Long option: mqtt-version */
+#define L_OPT_MQTT_VERSION  "mqtt-version"
+
+/** @brief Program context definition */
+typedef struct program_ctx {
+  /** Number of iterations of each case */
+  long iterations;
+  /** MQTT protocol's version to benchmark, 0 means all supported versions */
+  uint8_t mqtt_version;
+} context_t;
+
+/** @brief Single result row */
+typedef struct bench_result {
+  /** Benchmark group */
+  const char *group;
+  /** Benchmarked operation */
+  const char *op;
+  /** MQTT protocol's version */
+  uint8_t version;
+  /** Topic length */
+  size_t topic_len;
+  /** Payload length */
+  size_t payload_len;
+  /** Number of properties */
+  size_t props;
+  /** Number of performed iterations */
+  long iterations;
+  /** Total elapsed time in nanoseconds */
+  uint64_t elapsed_ns;
+  /** Number of bytes processed by all iterations */
+  uint64_t bytes;
+  /** Number of allocations made by all iterations */
+  uint64_t allocs;
+  /** Return code of the benchmarked operation */
+  uint16_t rc;
+} bench_result_t;
+
+#endif /* __COMMON_H__ */
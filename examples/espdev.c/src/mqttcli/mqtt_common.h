@@ -110,6 +110,8 @@ struct mqtt_common_ctx;
 #define MQTT_NOT_SUPPORTED       ( (uint16_t) 0x0A0D )
 #define MQTT_NOT_INITIALIZED     ( (uint16_t) 0x0A0E )
 #define MQTT_CONN_REJECTED       ( (uint16_t) 0x0A0F )
+#define MQTT_THROTTLED           ( (uint16_t) 0x0A10 )
+#define MQTT_PKT_TOO_LARGE       ( (uint16_t) 0x0A11 )
 
 typedef enum {
   /** Byte */
@@ -0,0 +1,63 @@
+#ifndef __MQTT_FRAMER_H__
+#define __MQTT_FRAMER_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Waiting for the packet type of Fixed Header */
+#define MQTT_FRAMER_TYPE      0
+/** Decoding Remaining Length */
+#define MQTT_FRAMER_LENGTH    1
+/** Waiting for the rest of the packet, i.e. Variable Header, properties and payload */
+#define MQTT_FRAMER_BODY      2
+
+typedef struct {
+  /** Maximum length of the packet, e.g. the receive buffer size */
+  size_t max_length;
+  /** Number of the bytes of the current packet already decoded */
+  size_t offset;
+  /** Remaining Length decoded so far */
+  size_t remaining;
+  /** Total length of the current packet, known in MQTT_FRAMER_BODY stage */
+  size_t length;
+  /** Decoding stage, one of MQTT_FRAMER_* */
+  uint8_t stage;
+  /** Incremental decoder of the packet boundaries */
+} mqtt_framer_t;
+
+/**
+ * @brief Initializes the decoder.
+ *
+ * @param framer pointer to the decoder
+ * @param max_length maximum length of the packet, longer packets are reported with MQTT_PKT_TOO_LARGE
+ */
+void     __ATTR mqtt_framer_init(mqtt_framer_t *framer, size_t max_length);
+/**
+ * @brief Continues decoding of the current packet with the bytes received so far.
+ *
+ * @param framer pointer to the decoder
+ * @param buf pointer to the first byte of the current packet
+ * @param len number of the bytes of the current packet received so far, including the ones passed before
+ * @param length pointer to the length of the complete packet
+ *
+ * @returns MQTT_SUCCESS if the packet is complete, the decoder is ready for the next packet following it, otherwise:
+ *          MQTT_PENDING_DATA if more bytes are needed,
+ *          MQTT_MALFORMED_PACKET if Remaining Length is encoded using more than 4 bytes or
+ *          MQTT_PKT_TOO_LARGE if the packet is longer than the maximum length.
+ *
+ * @note Only the bytes not passed before are decoded, the body is not examined at all, so the cost of the partial reads
+ *       is linear in the number of received bytes. The buffer could be moved between the calls, the decoder stores offsets only.
+ * @note After an error the decoder shall be initialized again, e.g. when the connection is closed.
+ */
+uint16_t __ATTR mqtt_framer_feed(mqtt_framer_t *framer, const uint8_t *buf, size_t len, size_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_FRAMER_H__
@@ -0,0 +1,110 @@
+#ifndef __MQTT_HA_H__
+#define __MQTT_HA_H__
+
+#include <stdint.h>
+#include <stdlib.h>
+#include "mqtt_common.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/** Switch entity, commands are received on the command topic */
+#define MQTT_HA_SWITCH          0
+/** Sensor entity, reports the measured values */
+#define MQTT_HA_SENSOR          1
+/** Binary sensor entity, reports on and off states */
+#define MQTT_HA_BINARY_SENSOR   2
+
+typedef struct {
+  /** Identifier of the device (ids) */
+  const char *ids;
+  /** Name of the device (name) */
+  const char *name;
+  /** Manufacturer (mf) */
+  const char *mf;
+  /** Model (mdl) */
+  const char *mdl;
+  /** Software version (sw) */
+  const char *sw;
+  /** Serial number (sn) */
+  const char *sn;
+  /** Hardware version (hw) */
+  const char *hw;
+  /** Device the entity belongs to, NULL members are skipped */
+} mqtt_ha_device_t;
+
+typedef struct {
+  /** Name of the software sending the discovery (name) */
+  const char *name;
+  /** Software version (sw) */
+  const char *sw;
+  /** Support URL (url) */
+  const char *url;
+  /** Origin of the discovery, NULL members are skipped */
+} mqtt_ha_origin_t;
+
+typedef struct {
+  /** Entity type, one of MQTT_HA_* */
+  uint8_t component;
+  /** Base topic (~), e.g. homeassistant/switch/{object_id}, the configuration is published to {base}/config */
+  const char *base;
+  /** Name of the entity (name), NULL writes null, i.e. the entity is named after the device */
+  const char *name;
+  /** Unique identifier (uniq_id) */
+  const char *unique_id;
+  /** Command topic relative to the base (cmd_t), used by the switch only */
+  const char *command_topic;
+  /** State topic relative to the base (stat_t) */
+  const char *state_topic;
+  /** Availability topic relative to the base (avty_t) */
+  const char *availability_topic;
+  /** Payload of on state (pl_on), used by the switch and binary sensor */
+  const char *payload_on;
+  /** Payload of off state (pl_off), used by the switch and binary sensor */
+  const char *payload_off;
+  /** Payload of available state (pl_avail) */
+  const char *payload_available;
+  /** Payload of not available state (pl_not_avail) */
+  const char *payload_not_available;
+  /** State reported when on (stat_on), used by the switch only */
+  const char *state_on;
+  /** State reported when off (stat_off), used by the switch only */
+  const char *state_off;
+  /** Device class (dev_cla), e.g. temperature */
+  const char *device_class;
+  /** Unit of measurement (unit_of_meas), used by the sensor only */
+  const char *unit_of_measurement;
+  /** Template extracting the value from the state payload (val_tpl) */
+  const char *value_template;
+  /** Set to 1 if the commands are published as retained (ret), used by the switch only */
+  uint8_t retain;
+  /** Set to 1 if the state is assumed from the commands (opt), used by the switch only */
+  uint8_t optimistic;
+  /** Device the entity belongs to (dev), NULL if not used */
+  const mqtt_ha_device_t *device;
+  /** Origin of the discovery (o), NULL if not used */
+  const mqtt_ha_origin_t *origin;
+  /** Home Assistant entity announced by MQTT discovery, NULL members are skipped */
+} mqtt_ha_entity_t;
+
+/**
+ * @brief Writes the discovery configuration of the entity using the abbreviated keys.
+ *
+ * @param entity pointer to the entity
+ * @param out pointer to the output buffer, the topic and message are appended
+ * @param params pointer to the structure representing parameters used to create PUBLISH packet, topic and message are set
+ *
+ * @returns MQTT_SUCCESS if the configuration was written, otherwise:
+ *          MQTT_INVALID_ARGS if invalid arguments were provided or
+ *          MQTT_OUT_OF_MEM if the configuration does not fit into the output buffer (nothing is appended).
+ *
+ * @note The strings are referenced only while the configuration is written.
+ */
+uint16_t __ATTR mqtt_ha_config(const mqtt_ha_entity_t *entity, clv_t *out, mqtt_publish_params_t *params);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __MQTT_HA_H__
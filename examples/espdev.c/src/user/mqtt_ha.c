@@ -0,0 +1,132 @@
+#include <c_types.h>
+#include <string.h>
+
+#include "../mqttcli/mqtt_ha.h"
+#include "../mqttcli/mqtt_json.h"
+
+/**
+ * @brief Writes the member with the string value, skipped if the value is NULL.
+ *
+ * @param json pointer to the writer
+ * @param key abbreviated key
+ * @param value value terminated with '\0'
+ */
+static void __ATTR mqtt_ha_string(mqtt_json_t *json, const char *key, const char *value) {
+  if(NULL != value) {
+    mqtt_json_key( json, key );
+    mqtt_json_string( json, value, strlen( value ) );
+  }
+}
+
+/**
+ * @brief Writes the member with the topic relative to the base, i.e. "~/{topic}", skipped if the topic is NULL.
+ *
+ * @param json pointer to the writer
+ * @param key abbreviated key
+ * @param topic topic terminated with '\0'
+ */
+static void __ATTR mqtt_ha_topic(mqtt_json_t *json, const char *key, const char *topic) {
+  lv_t parts[2] = {
+    { .length = 2, .value = (uint8_t*) "~/" },
+    { .length = 0, .value = (uint8_t*) topic }
+  };
+
+  if(NULL != topic) {
+    parts[1].length = strlen( topic );
+    mqtt_json_key( json, key );
+    mqtt_json_string_ex( json, parts, 2 );
+  }
+}
+
+uint16_t __ATTR mqtt_ha_config(const mqtt_ha_entity_t *entity, clv_t *out, mqtt_publish_params_t *params) {
+  mqtt_json_t json;
+  size_t start, len;
+  uint16_t rc;
+
+  if(NULL == entity || NULL == out || NULL == params || NULL == entity->base || entity->component > MQTT_HA_BINARY_SENSOR) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  /* Topic: {base}/config */
+  start = out->length;
+  len = strlen( entity->base );
+  if(out->capacity - out->length < len + 7) {
+    return MQTT_OUT_OF_MEM;
+  }
+  memcpy( out->value + out->length, entity->base, len );
+  memcpy( out->value + out->length + len, "/config", 7 );
+  out->length += len + 7;
+
+  mqtt_json_init( &json, out );
+  mqtt_json_object( &json );
+  mqtt_ha_string( &json, "~", entity->base );
+  mqtt_json_key( &json, "name" );
+  if(NULL != entity->name) {
+    mqtt_json_string( &json, entity->name, strlen( entity->name ) );
+  } else {
+    mqtt_json_null( &json );
+  }
+  mqtt_ha_string( &json, "uniq_id", entity->unique_id );
+  if(MQTT_HA_SWITCH == entity->component) {
+    mqtt_ha_topic( &json, "cmd_t", entity->command_topic );
+  }
+  mqtt_ha_topic( &json, "stat_t", entity->state_topic );
+  mqtt_ha_topic( &json, "avty_t", entity->availability_topic );
+  if(MQTT_HA_SENSOR != entity->component) {
+    mqtt_ha_string( &json, "pl_on", entity->payload_on );
+    mqtt_ha_string( &json, "pl_off", entity->payload_off );
+  }
+  mqtt_ha_string( &json, "pl_avail", entity->payload_available );
+  mqtt_ha_string( &json, "pl_not_avail", entity->payload_not_available );
+  mqtt_ha_string( &json, "dev_cla", entity->device_class );
+  mqtt_ha_string( &json, "val_tpl", entity->value_template );
+  if(MQTT_HA_SWITCH == entity->component) {
+    mqtt_ha_string( &json, "stat_on", entity->state_on );
+    mqtt_ha_string( &json, "stat_off", entity->state_off );
+    mqtt_json_key( &json, "ret" );
+    mqtt_json_bool( &json, entity->retain );
+    mqtt_json_key( &json, "opt" );
+    mqtt_json_bool( &json, entity->optimistic );
+  }
+  if(MQTT_HA_SENSOR == entity->component) {
+    mqtt_ha_string( &json, "unit_of_meas", entity->unit_of_measurement );
+  }
+  if(NULL != entity->device) {
+    mqtt_json_key( &json, "dev" );
+    mqtt_json_object( &json );
+    if(NULL != entity->device->ids) {
+      mqtt_json_key( &json, "ids" );
+      mqtt_json_array( &json );
+      mqtt_json_string( &json, entity->device->ids, strlen( entity->device->ids ) );
+      mqtt_json_close( &json );
+    }
+    mqtt_ha_string( &json, "name", entity->device->name );
+    mqtt_ha_string( &json, "mf", entity->device->mf );
+    mqtt_ha_string( &json, "mdl", entity->device->mdl );
+    mqtt_ha_string( &json, "sw", entity->device->sw );
+    mqtt_ha_string( &json, "sn", entity->device->sn );
+    mqtt_ha_string( &json, "hw", entity->device->hw );
+    mqtt_json_close( &json );
+  }
+  if(NULL != entity->origin) {
+    mqtt_json_key( &json, "o" );
+    mqtt_json_object( &json );
+    mqtt_ha_string( &json, "name", entity->origin->name );
+    mqtt_ha_string( &json, "sw", entity->origin->sw );
+    mqtt_ha_string( &json, "url", entity->origin->url );
+    mqtt_json_close( &json );
+  }
+  mqtt_json_close( &json );
+
+  if(MQTT_SUCCESS != (rc = mqtt_json_end( &json ))) {
+    out->length = start;
+    return rc;
+  }
+
+  params->topic.value = out->value + start;
+  params->topic.length = len + 7;
+  params->message.value = out->value + start + len + 7;
+  params->message.length = out->length - start - len - 7;
+
+  return MQTT_SUCCESS;
+}
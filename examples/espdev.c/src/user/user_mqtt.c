@@ -4,6 +4,8 @@
 
 #include "../include/user_config.h"
 #include "../mqttcli/mqtt_cli.h"
+#include "../mqttcli/mqtt_framer.h"
+#include "../mqttcli/mqtt_ha.h"
 #include "user_mqtt.h"
 #include "user_net.h"
 #include "user_log.h"
@@ -45,9 +47,46 @@ struct espconn *espconn;
 extern const size_t big_buffer_len;
 extern uint8_t big_buffer[1024];
 clv_t data = { .capacity=sizeof(big_buffer)/sizeof(big_buffer[0]), .value=big_buffer };
+/** Received bytes not passed to process() yet, TCP segments could split or join the packets */
+static uint8_t rx_buf[sizeof(big_buffer)/sizeof(big_buffer[0])];
+/** Number of the bytes in rx_buf */
+static size_t rx_len = 0;
+/** Decoder of the packet received partially */
+static mqtt_framer_t framer;
 
 static void ICACHE_FLASH_ATTR mqtt_handler(os_event_t *e);
 
+/**
+ * @brief Passes the next complete packet from rx_buf to the handler, if the data buffer is not in use.
+ */
+static void ICACHE_FLASH_ATTR mqtt_rx_deliver(void) {
+  size_t length;
+  uint16_t rc;
+
+  if( data.length > 0 || 0 == rx_len ) {
+    return;
+  }
+  /* Only the bytes received since the previous call are decoded */
+  rc = mqtt_framer_feed( &framer, rx_buf, rx_len, &length );
+  if( MQTT_PENDING_DATA == rc ) {
+    return;
+  }
+  if( MQTT_SUCCESS != rc ) {
+    TOLOG(LOG_ERR, "malformed packet");
+    rx_len = 0;
+    mqtt_framer_init( &framer, data.capacity );
+    system_os_post(MQTT_HANDLER_ID, SIG_CLOSE, 0);
+    return;
+  }
+  os_memcpy(data.value, rx_buf, length);
+  data.length = length;
+  rx_len -= length;
+  os_memmove(rx_buf, rx_buf + length, rx_len);
+
+  /* Send the event */
+  system_os_post(MQTT_HANDLER_ID, SIG_RX, 0);
+}
+
 void ICACHE_FLASH_ATTR mqtt_restart_cb (void *arg) {
   /* Disarm timers */
   os_timer_disarm(&mqtt_idle_timer);
@@ -119,6 +158,8 @@ void ICACHE_FLASH_ATTR mqtt_ready_cb(void *arg) {
 
   /** Store current connection data */
   espconn = arg;
+  rx_len = 0;
+  mqtt_framer_init( &framer, data.capacity );
 
   /* Start idle timer */
   os_timer_disarm(&mqtt_idle_timer);
@@ -152,23 +193,18 @@ void ICACHE_FLASH_ATTR mqtt_recv_cb(void *arg, char *pdata, unsigned short len)
   os_timer_disarm(&mqtt_idle_timer);
 
   /* If the packet length is incorrect */
-  if( big_buffer_len < len || 0 == len) {
+  if( sizeof(rx_buf) - rx_len < len || 0 == len) {
     TOLOG(LOG_ERR,"recv data too big");
     return;
   }
 
-  if(data.length > 0 ) {
-    TOLOG(LOG_ERR,"data in use");
-    return;
-  }
-
-  /* Copy received data */
-  os_memcpy(data.value, pdata, len);
-  data.length = len;
+  /* Copy received data, the packet is processed once it is complete */
+  os_memcpy(rx_buf + rx_len, pdata, len);
+  rx_len += len;
 
   TOLOG(LOG_ERR, "Receiving length: ");
   os_memset(tab, 0x00, sizeof(tab)/sizeof(tab[0]));
-  os_sprintf(tab, "%d", data.length);
+  os_sprintf(tab, "%d", len);
   TOLOG(LOG_ERR, tab);
   //for(i=0; i<data.length; ++i) {
   //  os_sprintf(tab, "%02x ", big_buffer[i]);
@@ -176,8 +212,7 @@ void ICACHE_FLASH_ATTR mqtt_recv_cb(void *arg, char *pdata, unsigned short len)
   //}
   //TOLOG(LOG_INFO, "\r\n");
 
-  /* Send the event */
-  system_os_post(MQTT_HANDLER_ID, SIG_RX, 0);
+  mqtt_rx_deliver();
 
   /* Start idle timer */
   os_timer_setfn(&mqtt_idle_timer, (os_timer_func_t *)mqtt_idle_cb, NULL);
@@ -218,6 +253,10 @@ void ICACHE_FLASH_ATTR mqtt_sent_cb(void *arg) {
     //os_timer_setfn(&mqtt_idle_timer, (os_timer_func_t *)mqtt_idle_cb, NULL);
     //os_timer_arm(&mqtt_idle_timer, DELAY_1_SEC, 0);
   }
+  else {
+    /* Packet received together with the previous one */
+    mqtt_rx_deliver();
+  }
 }
 
 int ICACHE_FLASH_ATTR get_gpio_num(uint8_t* name, size_t name_len) {
@@ -253,50 +292,41 @@ int ICACHE_FLASH_ATTR get_gpio_num(uint8_t* name, size_t name_len) {
 mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
   extern struct user_cfg cfg;
   mqtt_rc_t rc = RC_SUCCESS;
-  uint8_t *message;
   uint8_t *ptr = NULL;
-  int offset;
+  char base[sizeof(cfg.ha_base_t) + sizeof(cfg.dev_name) + sizeof(cfg.ha_node_id) + sizeof(cfg.dev_id)];
   mqtt_publish_params_t publish_params = { };
   mqtt_subscribe_params_t subscribe_params = { };
+  mqtt_ha_device_t device = {
+    .ids = cfg.dev_id, .name = cfg.dev_id, .mf = "Innovasoft", .mdl = cfg.dev_name, .sw = cfg.dev_sw, .sn = cfg.dev_id, .hw = cfg.dev_hw
+  };
+  mqtt_ha_origin_t origin = { .name = "ESP-OS", .sw = cfg.dev_sw, .url = "https://www.innovasoft.org" };
+  mqtt_ha_entity_t entity = {
+    .component = MQTT_HA_SWITCH,
+    .base = base,
+    .unique_id = cfg.dev_id,
+    .command_topic = cfg.ha_cmd_t,
+    .state_topic = cfg.ha_stat_t,
+    .availability_topic = cfg.ha_avty_t,
+    .payload_on = cfg.ha_pl_on,
+    .payload_off = cfg.ha_pl_off,
+    .payload_available = cfg.ha_pl_avail,
+    .payload_not_available = cfg.ha_pl_not_avail,
+    .state_on = cfg.ha_stat_on,
+    .state_off = cfg.ha_stat_off,
+    .device = &device,
+    .origin = &origin
+  };
+  /* The data buffer is the one being processed, its length shall stay untouched */
+  clv_t out = { .capacity=data.capacity, .length=0, .value=data.value };
   
   /* Publishing configuration */
-  ptr = data.value;
-  publish_params.topic.value = ptr;
   if(cfg.ha_node_id_len) {
-    publish_params.topic.length = os_sprintf( ptr, "%s/%s/%s/%s/config", cfg.ha_base_t, cfg.dev_name, cfg.ha_node_id, cfg.dev_id);
+    os_sprintf( base, "%s/%s/%s/%s", cfg.ha_base_t, cfg.dev_name, cfg.ha_node_id, cfg.dev_id );
   }
   else {
-    publish_params.topic.length = os_sprintf( ptr, "%s/%s/%s/config", cfg.ha_base_t, cfg.dev_name, cfg.dev_id);
+    os_sprintf( base, "%s/%s/%s", cfg.ha_base_t, cfg.dev_name, cfg.dev_id );
   }
-  message = publish_params.message.value = ptr + publish_params.topic.length;
-  offset = 0;
-  message[0] = '{';
-  offset += 1;
-  if(cfg.ha_node_id_len) {
-    offset += os_sprintf( message + offset, "\"~\": \"%s/%s/%s/%s\",", cfg.ha_base_t, cfg.dev_name, cfg.ha_node_id, cfg.dev_id );
-  }
-  else {
-    offset += os_sprintf( message + offset, "\"~\": \"%s/%s/%s\",", cfg.ha_base_t, cfg.dev_name, cfg.dev_id );
-  }
-  offset += os_sprintf( message + offset, "\"name\": null,");
-  offset += os_sprintf( message + offset, "\"uniq_id\": \"%s\",", cfg.dev_id);
-  offset += os_sprintf( message + offset, "\"cmd_t\": \"~/%s\",", cfg.ha_cmd_t);
-  offset += os_sprintf( message + offset, "\"stat_t\": \"~/%s\",", cfg.ha_stat_t);
-  offset += os_sprintf( message + offset, "\"avty_t\": \"~/%s\",", cfg.ha_avty_t);
-  offset += os_sprintf( message + offset, "\"schema\": \"json\",");
-  offset += os_sprintf( message + offset, "\"pl_on\": \"%s\",", cfg.ha_pl_on);
-  offset += os_sprintf( message + offset, "\"pl_off\": \"%s\",", cfg.ha_pl_off);
-  offset += os_sprintf( message + offset, "\"pl_avail\" : \"%s\",", cfg.ha_pl_avail);
-  offset += os_sprintf( message + offset, "\"pl_not_avail\": \"%s\",", cfg.ha_pl_not_avail);
-  offset += os_sprintf( message + offset, "\"stat_on\": \"%s\",", cfg.ha_stat_on);
-  offset += os_sprintf( message + offset, "\"stat_off\": \"%s\",", cfg.ha_stat_off);
-  offset += os_sprintf( message + offset, "\"ret\": \"false\",");
-  offset += os_sprintf( message + offset, "\"opt\": \"false\",");
-  offset += os_sprintf( message + offset, "\"dev\": {\"ids\": [\"%s\"],\"name\": \"%s\",\"mf\": \"Innovasoft\",\"mdl\": \"%s\",\"sw\": \"%s\",\"sn\": \"%s\",\"hw\": \"%s\"},", cfg.dev_id, cfg.dev_id, cfg.dev_name, cfg.dev_sw, cfg.dev_id, cfg.dev_hw);
-  offset += os_sprintf( message + offset, "\"o\": {\"name\":\"ESP-OS\",\"sw\": \"%s\",\"url\": \"https://www.innovasoft.org\"}", cfg.dev_sw);
-  offset += os_sprintf( message + offset, "}");
-  publish_params.message.length = offset;
-  if( MQTT_SUCCESS != self->publish(self, &publish_params) ) {
+  if( MQTT_SUCCESS != mqtt_ha_config( &entity, &out, &publish_params ) || MQTT_SUCCESS != self->publish(self, &publish_params) ) {
     rc =  RC_IMPL_SPEC_ERR;
     goto finish;
   }
@@ -590,6 +620,10 @@ static void ICACHE_FLASH_ATTR mqtt_handler(os_event_t *e) {
           TOLOG(LOG_ERR, "");
         }
       }
+      else {
+        /* Nothing to send, the next received packet could be processed at once */
+        mqtt_rx_deliver();
+      }
       break;
     default:
       break;
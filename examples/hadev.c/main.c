@@ -19,6 +19,10 @@
 #include "utils.h"
 #include "utils.h"
 #include "../../api/mqtt_cli.h"
+#include "../../api/mqtt_framer.h"
+#include "../../api/mqtt_ha.h"
+#include "../../api/mqtt_pipeline.h"
+#include "../../api/mqtt_queue.h"
 
 const char* unique_id = "hadev123456";
 const char* base_topic = "homeassistant/switch/hadev123456";
@@ -41,6 +45,14 @@ static clv_t* buffer;
 /* Stores current switch state (on or off) */
 static uint8_t toggle = 0;
 
+/** Packets sent right behind CONNECT in optimistic mode */
+static mqtt_pipeline_t pipeline;
+
+/** Latest availability and state kept while not connected */
+static mqtt_queue_t queue;
+static mqtt_queue_slot_t queue_slots[QUEUE_SLOTS];
+static uint8_t queue_buf[QUEUE_SLOTS * QUEUE_SLOT_SIZE];
+
 static struct option long_options[] = {
   {L_OPT_HOST,        required_argument,  0,  S_OPT_HOST},
   {L_OPT_PORT,        required_argument,  0,  S_OPT_PORT},
@@ -50,6 +62,7 @@ static struct option long_options[] = {
   {L_OPT_USERNAME,    required_argument,  0,  S_OPT_USERNAME},
   {L_OPT_PASSWORD,    required_argument,  0,  S_OPT_PASSWORD},
   {L_OPT_VERBOSE,     no_argument,        0,  S_OPT_VERBOSE},
+  {L_OPT_OPTIMISTIC,  no_argument,        0,  S_OPT_OPTIMISTIC},
   {NULL,              no_argument,        0,  0}
 };
 
@@ -79,7 +92,7 @@ int validate_args(int argc, char **argv) {
   }
 
   while( 1 ) {
-    c = getopt_long( argc, argv,"vh:p:b:t:m:I:N:P:", long_options, &idx );
+    c = getopt_long( argc, argv,"voh:p:b:t:m:I:N:P:", long_options, &idx );
     /* Detect the end of the options */
     if( c == -1) {
       break;
@@ -90,6 +103,9 @@ int validate_args(int argc, char **argv) {
         ctx.log_fd = stdout;
         ctx.log_max_level = LOG_INFO;
         break;
+      case S_OPT_OPTIMISTIC:
+        ctx.optimistic = 1;
+        break;
       case S_OPT_USERID:
         length = strlen( optarg );
         if(length > sizeof(ctx.userid) / sizeof(char) ) {
@@ -189,6 +205,7 @@ void usage(const char* program) {
   printf(" -%c host_name, --%s host_name\r\n\t%s\r\n", S_OPT_HOST,        L_OPT_HOST,          "Sets remote host name or IP address.");
   printf(" -%c port, --%s port\r\n\t%s\r\n",           S_OPT_PORT,        L_OPT_PORT,          "Sets the remote port to be used.");
   printf(" -%c, --%s\r\n\t%s\r\n",                     S_OPT_VERBOSE,     L_OPT_VERBOSE,       "Runs the program in verbose mode.");
+  printf(" -%c, --%s\r\n\t%s\r\n",                     S_OPT_OPTIMISTIC,  L_OPT_OPTIMISTIC,    "Sends the device configuration right behind CONNECT without waiting for CONNACK.");
   printf(" --%s\r\n\t%s\r\n",                          L_OPT_REUSE_ADDR,                       "Turns on to reuse the the address.");
 	printf("\r\n");
 }
@@ -330,6 +347,7 @@ int process_and_send_data(int sock, mqtt_cli_t *cli, clv_t *data, mqtt_channel_t
   int result = RESULT_OK;
   uint16_t rc;
   size_t send_len;
+  lv_t packets;
 
   tv.tv_sec = 0;
 	tv.tv_usec = 5000;
@@ -349,48 +367,67 @@ int process_and_send_data(int sock, mqtt_cli_t *cli, clv_t *data, mqtt_channel_t
       }
     }
 
+    /* Sending queued packets right behind CONNECT */
+    if( ctx.optimistic ) {
+      mqtt_pipeline_get( &pipeline, data, &packets );
+      if( packets.length && (result = send_data(sock, packets.value, &(packets.length), log_str, log_str_len)) != RESULT_OK) {
+        break;
+      }
+    }
+
     data->length = 0;
   } while( rc == MQTT_PENDING_DATA ); /* Processing and sending */
 
   return result;
 }
 
+/**
+ * @brief Prepares the device configuration used by Home Assistant discovery.
+ * @param params PUBLISH parameters to fill, the topic and message are stored in the global buffer
+ * @returns MQTT_SUCCESS if the configuration fits into the global buffer, otherwise error code
+ */
+uint16_t build_config(mqtt_publish_params_t *params) {
+  static const mqtt_ha_device_t device = {
+    .ids = "ea334450945afc", .name = "acme_dev", .mf = "ACME", .mdl = "xya", .sw = "1.0", .sn = "ea334450945afc", .hw = "1.0rev2"
+  };
+  static const mqtt_ha_origin_t origin = { .name = "mqttcli", .sw = "1.0", .url = "https://innovasoft.org" };
+  mqtt_ha_entity_t entity = {
+    .component = MQTT_HA_SWITCH,
+    .base = base_topic,
+    .unique_id = unique_id,
+    .command_topic = command_topic,
+    .state_topic = state_topic,
+    .availability_topic = availability_topic,
+    .payload_on = payload_on,
+    .payload_off = payload_off,
+    .payload_available = payload_available,
+    .payload_not_available = payload_not_available,
+    .state_on = state_on,
+    .state_off = state_off,
+    .device = &device,
+    .origin = &origin
+  };
+  /* The global buffer is the one being processed, its length shall stay untouched */
+  clv_t out = { .capacity=buffer->capacity, .length=0, .value=buffer->value };
+
+  return mqtt_ha_config( &entity, &out, params );
+}
+
 mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
   mqtt_rc_t rc = RC_SUCCESS;
-  uint8_t *message;
-  int offset;
   mqtt_publish_params_t publish_params = { };
   mqtt_subscribe_params_t subscribe_params = { };
 
-  /* Publishing configuration */
-  publish_params.topic.value = buffer->value;
-  publish_params.topic.length = sprintf( buffer->value, "%s/config", base_topic );
-  message = publish_params.message.value = buffer->value + publish_params.topic.length;
-  offset = 0;
-  message[0] = '{';
-  offset += 1;
-  offset += sprintf( message + offset, "\"~\": \"%s\",", base_topic );
-  offset += sprintf( message + offset, "\"name\": null,");
-  offset += sprintf( message + offset, "\"uniq_id\": \"%s\",", unique_id);
-  offset += sprintf( message + offset, "\"cmd_t\": \"~/%s\",", command_topic);
-  offset += sprintf( message + offset, "\"stat_t\": \"~/%s\",", state_topic);
-  offset += sprintf( message + offset, "\"avty_t\": \"~/%s\",", availability_topic);
-  offset += sprintf( message + offset, "\"schema\": \"json\",");
-  offset += sprintf( message + offset, "\"pl_on\": \"%s\",", payload_on);
-  offset += sprintf( message + offset, "\"pl_off\": \"%s\",", payload_off);
-  offset += sprintf( message + offset, "\"pl_avail\" : \"%s\",", payload_available);
-  offset += sprintf( message + offset, "\"pl_not_avail\": \"%s\",", payload_not_available);
-  offset += sprintf( message + offset, "\"stat_on\": \"%s\",", state_on);
-  offset += sprintf( message + offset, "\"stat_off\": \"%s\",", state_off);
-  offset += sprintf( message + offset, "\"ret\": \"false\",");
-  offset += sprintf( message + offset, "\"opt\": \"false\",");
-  offset += sprintf( message + offset, "\"dev\": {\"ids\": \"ea334450945afc\",\"name\": \"acme_dev\",\"mf\": \"ACME\",\"mdl\": \"xya\",\"sw\": \"1.0\",\"sn\": \"ea334450945afc\",\"hw\": \"1.0rev2\"},");
-  offset += sprintf( message + offset, "\"o\": {\"name\":\"mqttcli\",\"sw\": \"1.0\",\"url\": \"https://innovasoft.org\"}");
-  offset += sprintf( message + offset, "}");
-  publish_params.message.length = offset;
-  if( MQTT_SUCCESS != self->publish(self, &publish_params) ) {
-    rc =  RC_IMPL_SPEC_ERR;
-    goto finish;   
+  /* Configuration was already sent behind CONNECT */
+  if( ctx.optimistic ) {
+    mqtt_pipeline_commit( &pipeline );
+  }
+  else {
+    /* Publishing configuration */
+    if( MQTT_SUCCESS != build_config( &publish_params ) || MQTT_SUCCESS != self->publish(self, &publish_params) ) {
+      rc =  RC_IMPL_SPEC_ERR;
+      goto finish;   
+    }
   }
 
   /* Subscribing to receive commands */
@@ -409,24 +446,31 @@ void cb_suback(const mqtt_cli_ctx_cb_t *self, const mqtt_suback_t *pkt, const mq
   uint8_t *message;
   mqtt_publish_params_t publish_params = { };
 
-  /* Publishing current device availability */
+  /* Queuing current device availability and state, values queued while not connected are replaced */
   publish_params.topic.value = buffer->value;
   publish_params.topic.length = sprintf( buffer->value, "%s/%s", base_topic, availability_topic );
   message = publish_params.message.value = buffer->value + publish_params.topic.length;
   publish_params.message.length = sprintf( message, "%s", payload_available );
-  if(MQTT_SUCCESS != self->publish(self, &publish_params)) {
+  if(MQTT_SUCCESS != mqtt_queue_push_ex( &queue, &publish_params, MQTT_QUEUE_LANE_CONTROL, (uint32_t) time(NULL) )) {
     goto finish;   
   }
 
-  /* Publishing current device state */
   publish_params.topic.value = buffer->value;
   publish_params.topic.length = sprintf( buffer->value, "%s/%s", base_topic, state_topic );
   message = publish_params.message.value = buffer->value + publish_params.topic.length;
   publish_params.message.length = sprintf( message, "%s", ( toggle > 0 ) ? state_on : state_off );
-  if(MQTT_SUCCESS != self->publish(self, &publish_params)) {
+  if(MQTT_SUCCESS != mqtt_queue_push_ex( &queue, &publish_params, MQTT_QUEUE_LANE_INTERACTIVE, (uint32_t) time(NULL) )) {
     goto finish;   
   }
 
+  /* Publishing the latest value of each topic, availability first */
+  while( mqtt_queue_peek( &queue, &publish_params, (uint32_t) time(NULL) ) ) {
+    if(MQTT_SUCCESS != self->publish(self, &publish_params)) {
+      goto finish;   
+    }
+    mqtt_queue_pop( &queue );
+  }
+
   /* Delay publishing to let HA initialize new device */
   sleep( 2 );
 
@@ -459,7 +503,7 @@ mqtt_rc_t cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, c
 }
 
 int main(int argc, char** argv) {
-  uint8_t *recv_buf = NULL, *tmp_buf = NULL;
+  uint8_t *recv_buf = NULL, *tmp_buf = NULL, *pipeline_buf = NULL;
   uint16_t rc;
   uint32_t srv_ip;
   size_t length, recv_buf_len, recv_buf_off, recv_len, i;
@@ -474,7 +518,8 @@ int main(int argc, char** argv) {
   mqtt_channel_t channel;
   struct itimerval timer;
   time_t now;
-  lv_t packet, cli_userid, cli_username, cli_password;
+  lv_t cli_userid, cli_username, cli_password;
+  mqtt_framer_t framer;
   mqtt_publish_params_t publish_params = {  };
   mqtt_will_params_t will_params = (mqtt_will_params_t) { };
   mqtt_params_t mqtt_params = { .max_pkt_id=8, .timeout=1, .version=4 };
@@ -630,6 +675,20 @@ int main(int argc, char** argv) {
     result = RESULT_FAILURE;
     goto finish;   
   }
+  mqtt_queue_init( &queue, MQTT_QUEUE_LAST_VALUE, queue_slots, QUEUE_SLOTS, queue_buf, QUEUE_SLOT_SIZE );
+  if( ctx.optimistic ) {
+    if( NULL == (pipeline_buf = malloc( ctx.buffer_size ) ) ) {
+      TOLOG(LOG_CRIT, "Not enough memory");
+      result = RESULT_FAILURE;
+      goto finish;
+    }
+    mqtt_pipeline_init( &pipeline, mqtt_params.version, pipeline_buf, ctx.buffer_size );
+    if( MQTT_SUCCESS != (rc = build_config( &publish_params )) || MQTT_SUCCESS != (rc = mqtt_pipeline_publish( &pipeline, &publish_params )) ) {
+      TOLOG(LOG_ERR,"mqtt_pipeline_publish( ... ), rc = %d", rc);
+      result = RESULT_FAILURE;
+      goto finish;
+    }
+  }
   if(ctx.verbose) {
     printf("OK\r\n");
   }
@@ -674,6 +733,7 @@ int main(int argc, char** argv) {
 	tv.tv_sec = 0;
 	tv.tv_usec = 0;
   recv_buf_off = 0;
+  mqtt_framer_init( &framer, recv_buf_len );
   while( 1 == ctx.state ) {
     /* Processing timeout (if any) */
     if( ctx.timer_int ) {
@@ -709,7 +769,10 @@ int main(int argc, char** argv) {
       publish_params.message.value = buffer->value + publish_params.topic.length;
       toggle = (toggle > 0) ? 0 : 1;
       publish_params.message.length = sprintf( buffer->value + publish_params.topic.length, "%s", ( toggle > 0 ) ? state_on : state_off);
-      cli.publish( &cli, &publish_params);
+      if(MQTT_SUCCESS != cli.publish( &cli, &publish_params)) {
+        /* Not connected yet, only the latest state is kept */
+        mqtt_queue_push_ex( &queue, &publish_params, MQTT_QUEUE_LANE_INTERACTIVE, (uint32_t) time(NULL) );
+      }
     }
 
     /* Prepare the read socket sets for network I/O notification */
@@ -763,11 +826,14 @@ int main(int argc, char** argv) {
         recv_buf_off += recv_len;
         length = 0;
 
-        packet.length = recv_buf_off;
-        packet.value = recv_buf;
-        cli.get_pkt_length(&cli, &packet, &length);
+        /* Only the newly received bytes of Fixed Header are decoded */
+        rc = mqtt_framer_feed( &framer, recv_buf, recv_buf_off, &length );
+        if( rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA ) {
+          TOLOG(LOG_ERR, "mqtt_framer_feed( ... ), rc = %d", rc);
+          goto finish;
+        }
 
-        if( recv_buf_off >= length) {
+        if( rc == MQTT_SUCCESS ) {
           memcpy( buffer->value, recv_buf, length);
           memmove( recv_buf, recv_buf+length, recv_buf_off - length);
           recv_buf_off -= length;
@@ -816,6 +882,9 @@ finish:
   if(NULL != recv_buf) {
     free( recv_buf );
   }
+  if(NULL != pipeline_buf) {
+    free( pipeline_buf );
+  }
   if(NULL != buffer->value) {
     free( buffer->value );
   }
@@ -18,6 +18,11 @@
 #define DEFAULT_PORT  1884
 #define DEFAULT_BUFFER_SIZE 1024
 
+/** Number of topics kept in the offline queue */
+#define QUEUE_SLOTS       4
+/** Size of the offline queue slot */
+#define QUEUE_SLOT_SIZE   256
+
 /* Short option: port */
 #define S_OPT_PORT          'p'
 /* Long option: port */
@@ -46,6 +51,10 @@
 #define S_OPT_PASSWORD      'P'
 /** Long option: password */
 #define L_OPT_PASSWORD      "password"
+/** Short option: optimistic */
+#define S_OPT_OPTIMISTIC   'o'
+/** Long option: optimistic */
+#define L_OPT_OPTIMISTIC   "optimistic"
 /** Short option: verbose */
 #define S_OPT_VERBOSE      'v'
 /** Long option: verbose */
@@ -90,6 +99,8 @@ typedef struct program_ctx {
   char password[MAX_PASSWORD_LEN+1];
   /** Verbose */
   uint8_t verbose;
+  /** Sends the device configuration right behind CONNECT */
+  uint8_t optimistic;
   /** Stores program state */
   uint8_t state;
   /** Stores timer interrupt status */
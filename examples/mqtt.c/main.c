@@ -25,12 +25,29 @@
 #include "main.h"
 #include "utils.h"
 #include "utils.h"
+#include "../../api/mqtt_ack.h"
 #include "../../api/mqtt_cli.h"
+#include "../../api/mqtt_dedup.h"
+#include "../../api/mqtt_framer.h"
+#include "../../api/mqtt_topic.h"
+#include "../../api/mqtt_subscription.h"
+#include "../../api/mqtt_limits.h"
 
 /** Program context */
 static context_t ctx;
+/** Subscriptions restored after each CONNACK without session */
+static mqtt_subscription_set_t subscriptions;
+/** Limits announced by the broker */
+static mqtt_limits_t limits;
+/** Packet Identifiers of QoS 1 messages already delivered */
+static mqtt_dedup_t dedup;
+/** QoS 1 messages whose PUBACK is deferred */
+static mqtt_ack_t ack;
+/** Packet Identifiers of the deferred messages */
+static uint16_t ack_ids[MAX_DEFERRED_ACKS];
 
 static struct option long_options[] = {
+  {L_OPT_ACK_BATCH,   required_argument,  0,  S_OPT_ACK_BATCH},
   {L_OPT_BUFFER_SIZE, required_argument,  0,  S_OPT_BUFFER_SIZE},
   {L_OPT_CAFILE,      required_argument,  0,  S_OPT_CAFILE},
   {L_OPT_CAPATH,      required_argument,  0,  S_OPT_CAPATH},
@@ -62,6 +79,7 @@ int validate_args(int argc, char **argv) {
 	int idx, substr_len, c;
   char* substr = NULL;
   size_t length;
+  lv_t topic;
 
 	/* Set default values */
   memset( &ctx, 0x00, sizeof(context_t) );
@@ -89,6 +107,9 @@ int validate_args(int argc, char **argv) {
       break;
     }
     switch(c) {
+      case S_OPT_ACK_BATCH:
+        ctx.ack_batch = atoi( optarg );
+        break;
       case S_OPT_BUFFER_SIZE:
         ctx.buffer_size = atoi( optarg );
         break;
@@ -211,11 +232,27 @@ int validate_args(int argc, char **argv) {
     return RESULT_FAILURE;
   }
 
+  if(ctx.ack_batch < 0 || ctx.ack_batch > MAX_DEFERRED_ACKS) {
+    TOLOG(LOG_ERR, "ack-batch option accepts values from 0 to %d", MAX_DEFERRED_ACKS);
+    return RESULT_FAILURE;
+  }
+
   if(ctx.subscribe && ( !ctx.topic[0] || ctx.message[0] ) ) {
     TOLOG(LOG_ERR, "subscribe option requires to specify only the topic");
     return RESULT_FAILURE;
   }
 
+  topic = (lv_t) {.length=strlen(ctx.topic), .value=ctx.topic };
+  if(ctx.publish && MQTT_SUCCESS != mqtt_topic_validate_name( &topic )) {
+    TOLOG(LOG_ERR, "Invalid topic name");
+    return RESULT_FAILURE;
+  }
+
+  if(ctx.subscribe && MQTT_SUCCESS != mqtt_topic_validate_filter( &topic )) {
+    TOLOG(LOG_ERR, "Invalid topic filter");
+    return RESULT_FAILURE;
+  }
+
 	return RC_SUCCESS;
 }
 
@@ -268,6 +305,7 @@ void usage(const char* program) {
   printf(" --%s\r\n\t%s\r\n",                          L_OPT_PUBLISH,                          "Runs the program to publish the packet.");
   printf(" --%s\r\n\t%s\r\n",                          L_OPT_SUBSCRIBE,                        "Runs the program to subscribe packets.");
   printf(" --%s\r\n\t%s\r\n",                          L_OPT_REUSE_ADDR,                       "Turns on to reuse the the address.");
+  printf(" --%s count\r\n\t%s\r\n",                    L_OPT_ACK_BATCH,                        "Sends PUBACK packets of received QoS 1 messages at once, when the count is reached or the timer expires.");
 	printf("\r\n");
 }
 
@@ -425,6 +463,36 @@ int send_data(int sock, SSL *ssl, uint8_t *buf, size_t *length, uint8_t *log_str
   return RESULT_OK;
 }
 
+/**
+ * @brief Sends PUBACK packets of the deferred messages at once.
+ * @param sock Socket to use
+ * @param ssl SSL connection to use, NULL if TLS is disabled
+ * @param data Buffer used to prepare the packets
+ * @param min Minimum number of the deferred messages to acknowledge
+ * @param log_str Buffer used to log the data
+ * @param log_str_len Length of the log buffer
+ * @return Returns RESULT_OK on success, otherwise the send_data() result
+ */
+int flush_acks(int sock, SSL *ssl, clv_t *data, size_t min, uint8_t *log_str, size_t log_str_len) {
+  uint16_t ids[MAX_DEFERRED_ACKS];
+  size_t count = ack.length;
+  uint16_t rc;
+
+  if( !count || count < min ) {
+    return RESULT_OK;
+  }
+
+  /* The deferred identifiers are removed by mqtt_ack_flush(), so they are copied first */
+  memcpy( ids, ack.ids, count * sizeof(uint16_t) );
+  data->length = 0;
+  if( MQTT_SUCCESS != (rc = mqtt_ack_flush( &ack, ids, count, data ))) {
+    TOLOG(LOG_ERR, "mqtt_ack_flush( ... ), rc = %d", rc);
+    return RESULT_FAILURE;
+  }
+
+  return send_data(sock, ssl, data->value, &(data->length), log_str, log_str_len);
+}
+
 int process_and_send_data(int sock, SSL *ssl, mqtt_cli_t *cli, clv_t *data, mqtt_channel_t *channel, uint8_t *log_str, size_t log_str_len) {
   fd_set writefds;
   struct timeval tv;
@@ -444,6 +512,8 @@ int process_and_send_data(int sock, SSL *ssl, mqtt_cli_t *cli, clv_t *data, mqtt
       break;
     }
 
+    /* PUBACK packets of the deferred messages are sent by flush_acks() */
+    mqtt_ack_strip( &ack, data );
     if( data->length ) {
       if( (result = send_data(sock, ssl, data->value, &(data->length), log_str, log_str_len)) != RESULT_OK) {
         break;
@@ -453,15 +523,38 @@ int process_and_send_data(int sock, SSL *ssl, mqtt_cli_t *cli, clv_t *data, mqtt
     data->length = 0;
   } while( rc == MQTT_PENDING_DATA ); /* Processing and sending */
 
+  if( result == RESULT_OK && ctx.ack_batch ) {
+    result = flush_acks(sock, ssl, data, ctx.ack_batch, log_str, log_str_len);
+    data->length = 0;
+  }
+
+  /* Restoring subscriptions after CONNACK (if any) */
+  while( result == RESULT_OK && subscriptions.restore < subscriptions.length ) {
+    rc = mqtt_subscription_restore( &subscriptions, cli, data );
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      TOLOG(LOG_ERR, "mqtt_subscription_restore( ... ), rc = %d", rc);
+      result = RESULT_FAILURE;
+      break;
+    }
+
+    if( data->length ) {
+      result = send_data(sock, ssl, data->value, &(data->length), log_str, log_str_len);
+    }
+
+    data->length = 0;
+  }
+
   return result;
 }
 
 mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
   uint16_t rc;
   uint8_t properties[] = {0x26, 0x00, 0x01, 'n', 0x00, 0x01, 'v'};
+  uint8_t shed_properties[sizeof(properties)];
   lv_t PROPERTIES = {.length=sizeof(properties)/sizeof(uint8_t), .value=properties };
   mqtt_publish_params_t publish_params;
-  mqtt_subscribe_params_t subscribe_params;
+
+  mqtt_limits_connack( &limits, self, pkt );
 
   if(ctx.publish == 1) {
     publish_params.flags = 0x02;
@@ -474,18 +567,18 @@ mqtt_rc_t cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, c
       publish_params.properties.value = NULL;
     }
     publish_params.topic = (lv_t) {.length=strlen(ctx.topic), .value=ctx.topic };
-    if( MQTT_SUCCESS != (rc = self->publish(self, &publish_params))) {
+    if( MQTT_SUCCESS != (rc = mqtt_limits_fit( &limits, &publish_params, shed_properties, sizeof(shed_properties) ))) {
+      TOLOG(LOG_CRIT, "Message exceeds Maximum Packet Size, rc = %d", rc);
+    }
+    else if( MQTT_SUCCESS != (rc = self->publish(self, &publish_params))) {
       TOLOG(LOG_CRIT, "publish() failed, rc = %d", rc);
     }
   }
   
-  if(ctx.subscribe == 1) {
-    subscribe_params.filter = (mqtt_subscribe_filter_t) {.length=strlen(ctx.topic), .options=1, .value=ctx.topic, };
-    subscribe_params.properties = (lv_t) {.length=0, .value=NULL };
-    if( MQTT_SUCCESS != (rc = self->subscribe(self, &subscribe_params))) {
-      TOLOG(LOG_CRIT, "subscribe() failed, rc = %d", rc);
-    }
-  }
+  /* Subscriptions are restored after process() returned */
+  mqtt_subscription_connack( &subscriptions, &limits, pkt, ctx.buffer_size );
+  mqtt_dedup_connack( &dedup, pkt );
+  mqtt_ack_connack( &ack, pkt );
 
   return RC_SUCCESS;
 }
@@ -497,6 +590,22 @@ mqtt_rc_t cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, c
   uint8_t *message = ctx.message;
   size_t offset;
 
+  if( MQTT_SUCCESS != mqtt_topic_validate_name( &pkt->topic )) {
+    TOLOG(LOG_ERR, "Invalid topic name received");
+    return RC_TOPIC_NAME_INV;
+  }
+
+  /* PUBACK is sent later together with the following ones, redelivered message stays deferred */
+  if( ctx.ack_batch && MQTT_SUCCESS != mqtt_ack_defer( &ack, pkt )) {
+    TOLOG(LOG_INFO, "Message acknowledged right away, id = %u", pkt->id);
+  }
+
+  /* Redelivered message is acknowledged again but not displayed */
+  if( mqtt_dedup_check( &dedup, pkt )) {
+    TOLOG(LOG_INFO, "Duplicate message suppressed, id = %u", pkt->id);
+    return RC_SUCCESS;
+  }
+
   if( topic[0] || message[0]) {
     topic[0] = 0;
     message[0] = 0;
@@ -534,7 +643,7 @@ mqtt_rc_t cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, c
 }
 
 int main(int argc, char** argv) {
-  uint8_t *send_buf = NULL, *recv_buf = NULL;
+  uint8_t *send_buf = NULL, *recv_buf = NULL, *swap_buf, *subscriptions_buf = NULL;
   uint16_t rc;
   uint32_t srv_ip;
   size_t length, recv_buf_len, recv_buf_off, send_buf_len, i;
@@ -550,7 +659,8 @@ int main(int argc, char** argv) {
   mqtt_channel_t channel;
   struct itimerval timer;
   time_t now;
-  lv_t packet, cli_userid, cli_username, cli_password;
+  lv_t cli_userid, cli_username, cli_password;
+  mqtt_framer_t framer;
   mqtt_publish_params_t publish_params;
   mqtt_subscribe_params_t subscribe_params;
   mqtt_params_t mqtt_params = {};
@@ -593,7 +703,6 @@ int main(int argc, char** argv) {
     goto finish;
   }
 
-  clv_t data = {.capacity=send_buf_len, .value=send_buf};
 
   /* Configure signal_handler as the signal handler for SIGALRM */
   memset (&sa, 0, sizeof (sa));
@@ -713,6 +822,23 @@ int main(int argc, char** argv) {
     result = RESULT_FAILURE;
     goto finish;    
   }
+  if( NULL == (subscriptions_buf = (unsigned char*) malloc (ctx.buffer_size ))) {
+    TOLOG(LOG_CRIT, "Not enough memory");
+    result = RESULT_FAILURE;
+    goto finish;
+  }
+  mqtt_subscription_init( &subscriptions, ctx.mqtt_version, subscriptions_buf, ctx.buffer_size );
+  mqtt_limits_init( &limits, ctx.mqtt_version );
+  mqtt_dedup_init( &dedup );
+  mqtt_ack_init( &ack, ack_ids, ctx.ack_batch );
+  if(ctx.subscribe == 1) {
+    subscribe_params.filter = (mqtt_subscribe_filter_t) {.length=strlen(ctx.topic), .options=1, .value=ctx.topic, };
+    if( MQTT_SUCCESS != (rc = mqtt_subscription_add( &subscriptions, &subscribe_params.filter )) ) {
+      TOLOG(LOG_ERR,"mqtt_subscription_add( ... ), rc = %d", rc);
+      result = RESULT_FAILURE;
+      goto finish;
+    }
+  }
   if(ctx.verbose) {
     printf("OK\r\n");
   }
@@ -864,6 +990,7 @@ int main(int argc, char** argv) {
 	tv.tv_sec = 0;
 	tv.tv_usec = 0;
   recv_buf_off = 0;
+  mqtt_framer_init( &framer, recv_buf_len );
   while( ctx.state ) {
     /* Printing received and saved topic and message (if any) */
     if( ctx.subscribe == 2 && ctx.topic[0] && ctx.message[0]) {
@@ -873,11 +1000,16 @@ int main(int argc, char** argv) {
     }
     /* Processing timeout (if any) */
     if(ctx.timer_int) {
+      clv_t data = {.capacity=send_buf_len, .length=0, .value=send_buf};
+
       ctx.timer_int = 0;
       channel.ip_address = 0;
       channel.user_id = 0;
-      data.length = 0;
       result = process_and_send_data(sock, ssl, &cli, &data, &channel, log_str, log_str_len);
+      /* Messages deferred since the last batch are acknowledged when the timer expires */
+      if(result == RESULT_OK) {
+        result = flush_acks(sock, ssl, &data, 1, log_str, log_str_len);
+      }
       if(result == RESULT_FAILURE) {
         TOLOG(LOG_ERR, "Sending failed");
         break;
@@ -962,19 +1094,28 @@ int main(int argc, char** argv) {
         recv_buf_off += recv_len;
         length = 0;
 
-        packet.length = recv_buf_off;
-        packet.value = recv_buf;
-        cli.get_pkt_length(&cli, &packet, &length);
+        /* Only the newly received bytes of Fixed Header are decoded */
+        rc = mqtt_framer_feed( &framer, recv_buf, recv_buf_off, &length );
+        if( rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA ) {
+          TOLOG(LOG_ERR, "mqtt_framer_feed( ... ), rc = %d", rc);
+          goto finish;
+        }
 
-        if( recv_buf_off >= length) {
-          memcpy( send_buf, recv_buf, length);
-          memmove( recv_buf, recv_buf+length, recv_buf_off - length);
+        if( rc == MQTT_SUCCESS ) {
+          /* The packet is processed in place; only the bytes following it are moved to the other buffer,
+             which becomes the receive buffer, so the packet itself is never copied */
+          clv_t data = {.capacity=send_buf_len, .length=length, .value=recv_buf};
+
+          memcpy( send_buf, recv_buf+length, recv_buf_off - length);
+          swap_buf = send_buf;
+          send_buf = recv_buf;
+          recv_buf = swap_buf;
           recv_buf_off -= length;
           recv_buf_len += length;
 
           if(ctx.verbose) {
             memset(log_str, 0x00, log_str_len);
-            format_data(send_buf, length, log_str, log_str_len);
+            format_data(data.value, length, log_str, log_str_len);
             log_str[1] = '=';
             log_str[2] = '>';
             printf("%s\r\n", log_str);
@@ -982,7 +1123,6 @@ int main(int argc, char** argv) {
 
           channel.ip_address = srv_ip;
           channel.user_id = 0;
-          data.length = length;
           result = process_and_send_data(sock, ssl, &cli, &data, &channel, log_str, log_str_len);
           if(result == RESULT_FAILURE) {
             TOLOG(LOG_ERR, "Sending failed");
@@ -1026,6 +1166,9 @@ finish:
   if( NULL != send_buf ) {
     free( send_buf );
   }
+  if( NULL != subscriptions_buf ) {
+    free( subscriptions_buf );
+  }
   if( NULL != ctx.cafile) {
     free( ctx.cafile );
   }
@@ -17,6 +17,8 @@
 #define DEFAULT_IP    "127.0.0.1"
 #define DEFAULT_PORT  1884
 #define DEFAULT_BUFFER_SIZE 1024
+/** Maximum number of QoS 1 messages whose PUBACK is deferred */
+#define MAX_DEFERRED_ACKS   64
 
 /* Short option: port */
 #define S_OPT_PORT          'p'
@@ -90,6 +92,10 @@
 #define S_OPT_KEY           '\7'
 /** Long option: key */
 #define L_OPT_KEY           "key"
+/** Short option: ack-batch */
+#define S_OPT_ACK_BATCH     '\10'
+/** Long option: ack-batch */
+#define L_OPT_ACK_BATCH     "ack-batch"
 
 #define LOG_EMERG 0
 #define LOG_ALERT 1
@@ -153,6 +159,8 @@ typedef struct program_ctx {
   char *cert;
   /** Stores the path to the user's certificate private key*/
   char* key;
+  /** Number of QoS 1 messages acknowledged at once, 0 if PUBACK is not deferred */
+  int ack_batch;
 } context_t;
 
 #define IS_MULTICAST(IPADDR) ( (IPADDR & 0x000000E0) == 0x000000E0 )
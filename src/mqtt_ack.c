@@ -0,0 +1,125 @@
+#include <string.h>
+
+#include "../api/mqtt_ack.h"
+
+/** QoS bits of PUBLISH packet */
+#define FLAG_QOS      0x06
+/** QoS 1 value of the QoS bits */
+#define FLAG_QOS1     0x02
+/** Session Present flag of CONNACK packet */
+#define FLAG_SESSION  0x01
+/** PUBACK packet type */
+#define TYPE_PUBACK   0x40
+
+/**
+ * @brief Finds the deferred message.
+ *
+ * @param ack pointer to the deferred acknowledgements
+ * @param id Packet Identifier
+ *
+ * @returns index of the message or ack->length if it is not deferred
+ */
+static size_t __ATTR mqtt_ack_find(const mqtt_ack_t *ack, uint16_t id) {
+  size_t i;
+
+  for(i=0; i<ack->length; ++i) {
+    if(ack->ids[i] == id) {
+      break;
+    }
+  }
+
+  return i;
+}
+
+void __ATTR mqtt_ack_init(mqtt_ack_t *ack, uint16_t *ids, size_t capacity) {
+  memset( ack, 0x00, sizeof(mqtt_ack_t) );
+  ack->ids = ids;
+  ack->capacity = capacity;
+}
+
+uint16_t __ATTR mqtt_ack_defer(mqtt_ack_t *ack, const mqtt_publish_t *pkt) {
+  if((pkt->flags & FLAG_QOS) != FLAG_QOS1) {
+    return MQTT_NOT_SUPPORTED;
+  }
+  if(mqtt_ack_find( ack, pkt->id ) < ack->length) {
+    return MQTT_SUCCESS;
+  }
+  if(ack->length >= ack->capacity) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  ack->ids[ack->length++] = pkt->id;
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_ack_strip(const mqtt_ack_t *ack, clv_t *data) {
+  size_t offset = 0, used, remaining, length;
+  uint8_t *buf = data->value;
+  uint8_t byte;
+
+  if(!ack->length) {
+    return;
+  }
+
+  while(offset < data->length) {
+    /* Decoding Fixed Header */
+    used = 1;
+    remaining = 0;
+    do {
+      if(offset + used >= data->length || used > 4) {
+        return;
+      }
+      byte = buf[offset + used];
+      remaining |= (size_t) (byte & 0x7F) << (7 * (used - 1));
+      ++used;
+    } while(byte & 0x80);
+    length = used + remaining;
+    if(offset + length > data->length) {
+      return;
+    }
+
+    if((buf[offset] & 0xF0) == TYPE_PUBACK && remaining >= 2 &&
+       mqtt_ack_find( ack, (uint16_t) ((buf[offset + used] << 8) | buf[offset + used + 1]) ) < ack->length) {
+      memmove( buf + offset, buf + offset + length, data->length - offset - length );
+      data->length -= length;
+    }
+    else {
+      offset += length;
+    }
+  }
+}
+
+uint16_t __ATTR mqtt_ack_flush(mqtt_ack_t *ack, const uint16_t *ids, size_t count, clv_t *output) {
+  size_t i, index;
+  uint8_t *buf;
+
+  if(NULL == ack || (count && NULL == ids) || NULL == output) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(count * MQTT_ACK_PUBACK_LEN > output->capacity - output->length) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  buf = output->value + output->length;
+  for(i=0; i<count; ++i) {
+    if((index = mqtt_ack_find( ack, ids[i] )) >= ack->length) {
+      continue;
+    }
+    /* The order of the deferred messages does not matter */
+    ack->ids[index] = ack->ids[--ack->length];
+    *buf++ = TYPE_PUBACK;
+    *buf++ = 0x02;
+    *buf++ = (uint8_t) (ids[i] >> 8);
+    *buf++ = (uint8_t) (ids[i]);
+  }
+  output->length = buf - output->value;
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_ack_connack(mqtt_ack_t *ack, const mqtt_connack_t *pkt) {
+  if(!(pkt->connect_ack_flags & FLAG_SESSION)) {
+    ack->length = 0;
+  }
+}
@@ -0,0 +1,375 @@
+#include <string.h>
+
+#include "../api/mqtt_cbor.h"
+#include "../api/mqtt_util.h"
+
+/** Payload Format Indicator property */
+#define PROP_PAYLOAD_FORMAT   0x01
+/** Content Type property */
+#define PROP_CONTENT_TYPE     0x03
+/** Additional information: single precision floating point number */
+#define INFO_FLOAT32          26
+/** Additional information: double precision floating point number */
+#define INFO_FLOAT64          27
+
+/**
+ * @brief Writes the value in big-endian order.
+ *
+ * @param buf pointer to the buffer
+ * @param value value to write
+ * @param len number of the bytes, 1, 2, 4 or 8
+ */
+static void __ATTR mqtt_cbor_write_be(uint8_t *buf, uint64_t value, size_t len) {
+  while(len--) {
+    buf[len] = (uint8_t) value;
+    value >>= 8;
+  }
+}
+
+/**
+ * @brief Reads the value stored in big-endian order.
+ *
+ * @param buf pointer to the buffer
+ * @param len number of the bytes, 1, 2, 4 or 8
+ *
+ * @returns value
+ */
+static uint64_t __ATTR mqtt_cbor_read_be(const uint8_t *buf, size_t len) {
+  uint64_t value = 0;
+
+  while(len--) {
+    value = (value << 8) | *buf++;
+  }
+
+  return value;
+}
+
+/**
+ * @brief Appends the initial byte and the argument using the shortest encoding, optionally followed by the bytes.
+ *
+ * @param out pointer to the output buffer
+ * @param major major type
+ * @param value argument, i.e. integer, length or count
+ * @param buf pointer to the bytes following the head, could be NULL
+ * @param len number of the bytes following the head
+ *
+ * @returns MQTT_SUCCESS or MQTT_OUT_OF_MEM
+ */
+static uint16_t __ATTR mqtt_cbor_put_head(clv_t *out, uint8_t major, uint64_t value, const void *buf, size_t len) {
+  uint8_t *dst;
+  size_t size;
+  uint8_t info;
+
+  if(value < 24) {
+    info = (uint8_t) value;
+    size = 0;
+  }
+  else if(value <= 0xFF) {
+    info = 24;
+    size = 1;
+  }
+  else if(value <= 0xFFFF) {
+    info = 25;
+    size = 2;
+  }
+  else if(value <= 0xFFFFFFFF) {
+    info = 26;
+    size = 4;
+  }
+  else {
+    info = 27;
+    size = 8;
+  }
+  if(NULL == out || out->length > out->capacity || out->capacity - out->length < 1 + size + len) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  dst = out->value + out->length;
+  dst[0] = (uint8_t) ((major << 5) | info);
+  mqtt_cbor_write_be( dst + 1, value, size );
+  if(len) {
+    memcpy( dst + 1 + size, buf, len );
+  }
+  out->length += 1 + size + len;
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Converts half precision floating point number.
+ *
+ * @param half encoded number
+ *
+ * @returns value
+ */
+static double __ATTR mqtt_cbor_half(uint16_t half) {
+  uint32_t exponent = (half >> 10) & 0x1F, mantissa = half & 0x3FF, bits;
+  float value;
+
+  if(exponent == 0) {
+    /* Subnormal numbers and zero: mantissa * 2^-24 */
+    value = (float) mantissa / 16777216.0f;
+    return (half & 0x8000) ? -value : value;
+  }
+
+  /* Re-biasing the exponent of the single precision number, infinity and NaN keep all exponent bits set */
+  bits = ((uint32_t) (half & 0x8000) << 16) | (mantissa << 13);
+  bits |= (exponent == 31) ? 0x7F800000 : (exponent - 15 + 127) << 23;
+  memcpy( &value, &bits, sizeof(value) );
+
+  return value;
+}
+
+uint16_t __ATTR mqtt_cbor_put_uint(clv_t *out, uint64_t value) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_UNSIGNED, value, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_int(clv_t *out, int64_t value) {
+  if(value < 0) {
+    return mqtt_cbor_put_head( out, MQTT_CBOR_NEGATIVE, (uint64_t) (-1 - value), NULL, 0 );
+  }
+
+  return mqtt_cbor_put_head( out, MQTT_CBOR_UNSIGNED, (uint64_t) value, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_bytes(clv_t *out, const uint8_t *buf, size_t len) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_BYTES, len, buf, len );
+}
+
+uint16_t __ATTR mqtt_cbor_put_text(clv_t *out, const char *buf, size_t len) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_TEXT, len, buf, len );
+}
+
+uint16_t __ATTR mqtt_cbor_put_array(clv_t *out, size_t count) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_ARRAY, count, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_map(clv_t *out, size_t count) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_MAP, count, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_tag(clv_t *out, uint64_t tag) {
+  return mqtt_cbor_put_head( out, MQTT_CBOR_TAG, tag, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_simple(clv_t *out, uint8_t value) {
+  if(value >= 24 && value < 32) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  return mqtt_cbor_put_head( out, MQTT_CBOR_SIMPLE, value, NULL, 0 );
+}
+
+uint16_t __ATTR mqtt_cbor_put_float(clv_t *out, float value) {
+  uint8_t buf[5];
+  uint32_t bits;
+
+  memcpy( &bits, &value, sizeof(bits) );
+  buf[0] = (MQTT_CBOR_SIMPLE << 5) | INFO_FLOAT32;
+  mqtt_cbor_write_be( buf + 1, bits, 4 );
+  if(NULL == out || out->length > out->capacity || out->capacity - out->length < sizeof(buf)) {
+    return MQTT_OUT_OF_MEM;
+  }
+  memcpy( out->value + out->length, buf, sizeof(buf) );
+  out->length += sizeof(buf);
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_cbor_put_double(clv_t *out, double value) {
+  uint8_t buf[9];
+  uint64_t bits;
+
+  memcpy( &bits, &value, sizeof(bits) );
+  buf[0] = (MQTT_CBOR_SIMPLE << 5) | INFO_FLOAT64;
+  mqtt_cbor_write_be( buf + 1, bits, 8 );
+  if(NULL == out || out->length > out->capacity || out->capacity - out->length < sizeof(buf)) {
+    return MQTT_OUT_OF_MEM;
+  }
+  memcpy( out->value + out->length, buf, sizeof(buf) );
+  out->length += sizeof(buf);
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_cbor_record_init(mqtt_cbor_record_t *record, uint8_t *buf, size_t capacity, const lv_t *keys, uint8_t count) {
+  clv_t out = { .capacity=capacity, .length=0, .value=buf };
+  uint8_t i;
+  uint16_t rc;
+
+  if(NULL == record || NULL == buf || NULL == keys || !count || count > MQTT_CBOR_MAX_FIELDS) {
+    return MQTT_INVALID_ARGS;
+  }
+  memset( record, 0x00, sizeof(mqtt_cbor_record_t) );
+
+  /* Keys are encoded once, values are written as zeros and replaced by mqtt_cbor_record_put() */
+  if(MQTT_SUCCESS != (rc = mqtt_cbor_put_map( &out, count ))) {
+    return rc;
+  }
+  for(i=0; i<count; ++i) {
+    if(MQTT_SUCCESS != (rc = mqtt_cbor_put_text( &out, (const char*) keys[i].value, keys[i].length ))) {
+      return rc;
+    }
+    if(out.length + 1 > 0xFFFF) {
+      return MQTT_OUT_OF_MEM;
+    }
+    record->offsets[i] = (uint16_t) (out.length + 1);
+    if(MQTT_SUCCESS != (rc = mqtt_cbor_put_float( &out, 0.0f ))) {
+      return rc;
+    }
+  }
+  record->value = buf;
+  record->length = out.length;
+  record->count = count;
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_cbor_record_put(const mqtt_cbor_record_t *record, clv_t *out, const float *values) {
+  uint8_t *dst;
+  uint32_t bits;
+  uint8_t i;
+
+  if(NULL == out || out->length > out->capacity || out->capacity - out->length < record->length) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  dst = out->value + out->length;
+  memcpy( dst, record->value, record->length );
+  for(i=0; i<record->count; ++i) {
+    memcpy( &bits, &values[i], sizeof(bits) );
+    mqtt_cbor_write_be( dst + record->offsets[i], bits, 4 );
+  }
+  out->length += record->length;
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_cbor_properties(mqtt_publish_params_t *params, uint8_t *buf, size_t capacity) {
+  uint8_t *properties;
+  size_t header, offset, size, length, properties_len;
+
+  if(NULL == params || NULL == buf) {
+    return MQTT_INVALID_ARGS;
+  }
+  header = 2 + 3 + sizeof(MQTT_CBOR_CONTENT_TYPE) - 1;
+  properties_len = params->properties.value ? params->properties.length : 0;
+  if(header + properties_len > capacity) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  /* Calculating the length of the kept properties before copying anything */
+  length = header;
+  for(offset=0; offset<properties_len; offset+=size) {
+    if(!(size = mqtt_util_property_size( params->properties.value + offset, properties_len - offset ))) {
+      return MQTT_INVALID_ARGS;
+    }
+    if(params->properties.value[offset] != PROP_PAYLOAD_FORMAT && params->properties.value[offset] != PROP_CONTENT_TYPE) {
+      length += size;
+    }
+  }
+  if(length > MAX_PROPERTIES_LEN) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  /* The current properties are moved behind the new ones, the buffer could be the same */
+  properties = buf + header;
+  if(properties_len) {
+    memmove( properties, params->properties.value, properties_len );
+  }
+  /* The property included twice is a Protocol Error, so the current Payload Format Indicator and Content Type are dropped */
+  length = 0;
+  for(offset=0; offset<properties_len; offset+=size) {
+    size = mqtt_util_property_size( properties + offset, properties_len - offset );
+    if(properties[offset] != PROP_PAYLOAD_FORMAT && properties[offset] != PROP_CONTENT_TYPE) {
+      memmove( properties + length, properties + offset, size );
+      length += size;
+    }
+  }
+  buf[0] = PROP_PAYLOAD_FORMAT;
+  buf[1] = 0x00;
+  buf[2] = PROP_CONTENT_TYPE;
+  buf[3] = 0x00;
+  buf[4] = sizeof(MQTT_CBOR_CONTENT_TYPE) - 1;
+  memcpy( buf + 5, MQTT_CBOR_CONTENT_TYPE, sizeof(MQTT_CBOR_CONTENT_TYPE) - 1 );
+  params->properties.value = buf;
+  params->properties.length = header + length;
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_cbor_reader_init(mqtt_cbor_reader_t *reader, const uint8_t *buf, size_t len) {
+  reader->value = buf;
+  reader->length = len;
+  reader->offset = 0;
+}
+
+uint16_t __ATTR mqtt_cbor_read(mqtt_cbor_reader_t *reader, mqtt_cbor_item_t *item) {
+  const uint8_t *buf;
+  size_t left, size;
+  uint64_t value;
+  uint32_t bits32;
+  float f;
+  uint8_t major, info;
+
+  if(reader->offset >= reader->length) {
+    return MQTT_INVALID_STATE;
+  }
+  buf = reader->value + reader->offset;
+  left = reader->length - reader->offset;
+  major = buf[0] >> 5;
+  info = buf[0] & 0x1F;
+
+  /* Argument */
+  if(info < 24) {
+    size = 0;
+    value = info;
+  }
+  else if(info <= 27) {
+    size = (size_t) 1 << (info - 24);
+    if(left < 1 + size) {
+      return MQTT_MALFORMED_PACKET;
+    }
+    value = mqtt_cbor_read_be( buf + 1, size );
+  }
+  else {
+    return MQTT_MALFORMED_PACKET;
+  }
+  memset( item, 0x00, sizeof(mqtt_cbor_item_t) );
+  item->type = major;
+  item->value = value;
+  left -= 1 + size;
+
+  switch(major) {
+    case MQTT_CBOR_BYTES:
+    case MQTT_CBOR_TEXT:
+      if(value > left) {
+        return MQTT_MALFORMED_PACKET;
+      }
+      item->data.length = (size_t) value;
+      item->data.value = (uint8_t*) buf + 1 + size;
+      size += (size_t) value;
+      break;
+    case MQTT_CBOR_SIMPLE:
+      if(info == 25) {
+        item->type = MQTT_CBOR_FLOAT;
+        item->number = mqtt_cbor_half( (uint16_t) value );
+      }
+      else if(info == INFO_FLOAT32) {
+        item->type = MQTT_CBOR_FLOAT;
+        bits32 = (uint32_t) value;
+        memcpy( &f, &bits32, sizeof(f) );
+        item->number = f;
+      }
+      else if(info == INFO_FLOAT64) {
+        item->type = MQTT_CBOR_FLOAT;
+        memcpy( &item->number, &value, sizeof(item->number) );
+      }
+      break;
+    default:
+      break;
+  }
+  reader->offset += 1 + size;
+
+  return MQTT_SUCCESS;
+}
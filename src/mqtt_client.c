@@ -0,0 +1,179 @@
+#include <string.h>
+
+#include "../api/mqtt_client.h"
+
+/**
+ * The library reads only the private context of mqtt_cli_t passed to the operations,
+ * which is the first member of both structures, so the client is passed instead.
+ */
+#define SELF(client)  ((const mqtt_cli_t*) (client))
+
+/** Operations shared by all clients, filled in by the first successful initialization */
+static mqtt_cli_t ops;
+/** Client whose process() is executed, used by the callbacks */
+static const mqtt_client_t *current;
+
+uint16_t __ATTR mqtt_client_init(mqtt_client_t *client, mqtt_params_t *params, void *user_data) {
+  mqtt_cli_t cli;
+  uint16_t rc;
+
+  memset( &cli, 0x00, sizeof(cli) );
+  rc = (NULL == params) ? mqtt_cli_init( &cli ) : mqtt_cli_init_ex( &cli, params );
+  if(MQTT_SUCCESS == rc && NULL == ops.process) {
+    ops = cli;
+    ops.ctx = NULL;
+  }
+  client->ctx = cli.ctx;
+  client->ops = &ops;
+  client->user_data = user_data;
+
+  return rc;
+}
+
+void __ATTR mqtt_client_destr(mqtt_client_t *client) {
+  mqtt_cli_t cli;
+
+  cli.ctx = client->ctx;
+  mqtt_cli_destr( &cli );
+  client->ctx = cli.ctx;
+}
+
+const mqtt_cli_t* __ATTR mqtt_client_ops(void) {
+  return (NULL == ops.process) ? NULL : &ops;
+}
+
+void* __ATTR mqtt_client_user_data(void) {
+  return (NULL == current) ? NULL : current->user_data;
+}
+
+uint16_t __ATTR mqtt_client_publish(const mqtt_client_t *client, const mqtt_publish_params_t *params) {
+  return client->ops->publish( SELF(client), params );
+}
+
+uint16_t __ATTR mqtt_client_publish_ex(const mqtt_client_t *client, const mqtt_publish_params_t *params, clv_t *output) {
+  return client->ops->publish_ex( SELF(client), params, output );
+}
+
+uint16_t __ATTR mqtt_client_subscribe(const mqtt_client_t *client, const mqtt_subscribe_params_t *params) {
+  return client->ops->subscribe( SELF(client), params );
+}
+
+uint16_t __ATTR mqtt_client_subscribe_ex(const mqtt_client_t *client, const mqtt_subscribe_params_t *params, clv_t *output) {
+  return client->ops->subscribe_ex( SELF(client), params, output );
+}
+
+uint16_t __ATTR mqtt_client_unsubscribe(const mqtt_client_t *client, const mqtt_unsubscribe_params_t *params) {
+  return client->ops->unsubscribe( SELF(client), params );
+}
+
+uint16_t __ATTR mqtt_client_unsubscribe_ex(const mqtt_client_t *client, const mqtt_unsubscribe_params_t *params, clv_t *output) {
+  return client->ops->unsubscribe_ex( SELF(client), params, output );
+}
+
+uint16_t __ATTR mqtt_client_process(const mqtt_client_t *client, clv_t *data, mqtt_channel_t *channel) {
+  const mqtt_client_t *previous = current;
+  uint16_t rc;
+
+  /* The callback could process another client */
+  current = client;
+  rc = client->ops->process( SELF(client), data, channel );
+  current = previous;
+
+  return rc;
+}
+
+void __ATTR mqtt_client_disconnect(const mqtt_client_t *client) {
+  client->ops->disconnect( SELF(client) );
+}
+
+void __ATTR mqtt_client_set_br_keepalive(const mqtt_client_t *client, const uint16_t keep_alive) {
+  client->ops->set_br_keepalive( SELF(client), keep_alive );
+}
+
+void __ATTR mqtt_client_get_br_keepalive(const mqtt_client_t *client, uint16_t *keep_alive) {
+  client->ops->get_br_keepalive( SELF(client), keep_alive );
+}
+
+void __ATTR mqtt_client_set_br_ip(const mqtt_client_t *client, const uint32_t ip) {
+  client->ops->set_br_ip( SELF(client), ip );
+}
+
+void __ATTR mqtt_client_get_br_ip(const mqtt_client_t *client, uint32_t *ip) {
+  client->ops->get_br_ip( SELF(client), ip );
+}
+
+uint16_t __ATTR mqtt_client_set_br_userid(const mqtt_client_t *client, const lv_t *user_id) {
+  return client->ops->set_br_userid( SELF(client), user_id );
+}
+
+void __ATTR mqtt_client_get_br_userid(const mqtt_client_t *client, lv_t *user_id) {
+  client->ops->get_br_userid( SELF(client), user_id );
+}
+
+uint16_t __ATTR mqtt_client_set_br_username(const mqtt_client_t *client, const lv_t *user_name) {
+  return client->ops->set_br_username( SELF(client), user_name );
+}
+
+void __ATTR mqtt_client_get_br_username(const mqtt_client_t *client, lv_t *user_name) {
+  client->ops->get_br_username( SELF(client), user_name );
+}
+
+uint16_t __ATTR mqtt_client_set_br_password(const mqtt_client_t *client, const lv_t *password) {
+  return client->ops->set_br_password( SELF(client), password );
+}
+
+void __ATTR mqtt_client_get_br_password(const mqtt_client_t *client, lv_t *password) {
+  client->ops->get_br_password( SELF(client), password );
+}
+
+uint16_t __ATTR mqtt_client_set_br_will(const mqtt_client_t *client, const mqtt_will_params_t *will) {
+  return client->ops->set_br_will( SELF(client), will );
+}
+
+void __ATTR mqtt_client_get_br_will(const mqtt_client_t *client, mqtt_will_params_t *will) {
+  client->ops->get_br_will( SELF(client), will );
+}
+
+void __ATTR mqtt_client_is_connected(const mqtt_client_t *client, uint8_t *is_connected) {
+  client->ops->is_connected( SELF(client), is_connected );
+}
+
+void __ATTR mqtt_client_get_pkt_length(const mqtt_client_t *client, lv_t *packet, size_t *length) {
+  client->ops->get_pkt_length( SELF(client), packet, length );
+}
+
+void __ATTR mqtt_client_get_lib_version(const mqtt_client_t *client, uint32_t *version) {
+  client->ops->get_lib_version( SELF(client), version );
+}
+
+void __ATTR mqtt_client_get_last_pkt(const mqtt_client_t *client, uint8_t *last_pkt) {
+  client->ops->get_last_pkt( SELF(client), last_pkt );
+}
+
+void __ATTR mqtt_client_get_buffersize(const mqtt_client_t *client, uint16_t *buffersize) {
+  client->ops->get_buffersize( SELF(client), buffersize );
+}
+
+void __ATTR mqtt_client_set_cb_disconnect(const mqtt_client_t *client, cb_mqtt_disconnect_t cb_mqtt_disconnect) {
+  client->ops->set_cb_disconnect( SELF(client), cb_mqtt_disconnect );
+}
+
+void __ATTR mqtt_client_set_cb_puback(const mqtt_client_t *client, cb_mqtt_puback_t cb_mqtt_puback) {
+  client->ops->set_cb_puback( SELF(client), cb_mqtt_puback );
+}
+
+void __ATTR mqtt_client_set_cb_publish(const mqtt_client_t *client, cb_mqtt_publish_t cb_mqtt_publish) {
+  client->ops->set_cb_publish( SELF(client), cb_mqtt_publish );
+}
+
+void __ATTR mqtt_client_set_cb_suback(const mqtt_client_t *client, cb_mqtt_suback_t cb_mqtt_suback) {
+  client->ops->set_cb_suback( SELF(client), cb_mqtt_suback );
+}
+
+void __ATTR mqtt_client_set_cb_connack(const mqtt_client_t *client, cb_mqtt_connack_t cb_mqtt_connack) {
+  client->ops->set_cb_connack( SELF(client), cb_mqtt_connack );
+}
+
+void __ATTR mqtt_client_set_cb_auth(const mqtt_client_t *client, cb_mqtt_auth_t cb_mqtt_auth) {
+  client->ops->set_cb_auth( SELF(client), cb_mqtt_auth );
+}
@@ -0,0 +1,48 @@
+#include <string.h>
+
+#include "../api/mqtt_dedup.h"
+
+/** DUP flag of PUBLISH packet */
+#define FLAG_DUP      0x08
+/** QoS bits of PUBLISH packet */
+#define FLAG_QOS      0x06
+/** QoS 1 value of the QoS bits */
+#define FLAG_QOS1     0x02
+/** Session Present flag of CONNACK packet */
+#define FLAG_SESSION  0x01
+
+void __ATTR mqtt_dedup_init(mqtt_dedup_t *dedup) {
+  memset( dedup, 0x00, sizeof(mqtt_dedup_t) );
+}
+
+void __ATTR mqtt_dedup_connack(mqtt_dedup_t *dedup, const mqtt_connack_t *pkt) {
+  if(pkt->connect_ack_flags & FLAG_SESSION) {
+    memcpy( dedup->previous, dedup->current, sizeof(dedup->previous) );
+  } else {
+    memset( dedup->previous, 0x00, sizeof(dedup->previous) );
+  }
+  memset( dedup->current, 0x00, sizeof(dedup->current) );
+}
+
+uint8_t __ATTR mqtt_dedup_check(mqtt_dedup_t *dedup, const mqtt_publish_t *pkt) {
+  size_t idx;
+  uint8_t mask;
+
+  if((pkt->flags & FLAG_QOS) != FLAG_QOS1) {
+    return 0;
+  }
+
+  idx = pkt->id >> 3;
+  mask = 1 << (pkt->id & 0x07);
+  if(!(pkt->flags & FLAG_DUP)) {
+    /* The broker received PUBACK of the previous message with this Packet Identifier */
+    dedup->previous[idx] &= ~mask;
+  } else if((dedup->current[idx] | dedup->previous[idx]) & mask) {
+    dedup->current[idx] |= mask;
+    ++dedup->suppressed;
+    return 1;
+  }
+  dedup->current[idx] |= mask;
+
+  return 0;
+}
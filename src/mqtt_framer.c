@@ -0,0 +1,59 @@
+#include <string.h>
+
+#include "../api/mqtt_framer.h"
+
+/** Maximum number of the bytes encoding Remaining Length */
+#define MAX_LENGTH_BYTES  4
+
+void __ATTR mqtt_framer_init(mqtt_framer_t *framer, size_t max_length) {
+  memset( framer, 0x00, sizeof(mqtt_framer_t) );
+  framer->max_length = max_length;
+  framer->stage = MQTT_FRAMER_TYPE;
+}
+
+uint16_t __ATTR mqtt_framer_feed(mqtt_framer_t *framer, const uint8_t *buf, size_t len, size_t *length) {
+  uint8_t byte;
+
+  /* Each stage continues where the previous call stopped */
+  switch(framer->stage) {
+    case MQTT_FRAMER_TYPE:
+      if(len < 1) {
+        return MQTT_PENDING_DATA;
+      }
+      framer->offset = 1;
+      framer->remaining = 0;
+      framer->stage = MQTT_FRAMER_LENGTH;
+      /* fall through */
+    case MQTT_FRAMER_LENGTH:
+      while(framer->offset < len) {
+        byte = buf[framer->offset];
+        framer->remaining |= (size_t) (byte & 0x7F) << (7 * (framer->offset - 1));
+        ++framer->offset;
+        if(!(byte & 0x80)) {
+          break;
+        }
+        if(framer->offset > MAX_LENGTH_BYTES) {
+          return MQTT_MALFORMED_PACKET;
+        }
+      }
+      if(framer->offset == 1 || (buf[framer->offset - 1] & 0x80)) {
+        return MQTT_PENDING_DATA;
+      }
+      framer->length = framer->offset + framer->remaining;
+      if(framer->length > framer->max_length) {
+        return MQTT_PKT_TOO_LARGE;
+      }
+      framer->stage = MQTT_FRAMER_BODY;
+      /* fall through */
+    default:
+      if(len < framer->length) {
+        return MQTT_PENDING_DATA;
+      }
+      break;
+  }
+
+  *length = framer->length;
+  framer->stage = MQTT_FRAMER_TYPE;
+
+  return MQTT_SUCCESS;
+}
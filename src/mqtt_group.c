@@ -0,0 +1,714 @@
+#define _GNU_SOURCE
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <stdio.h>
+#include <unistd.h>	/* close */
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+
+#include "../api/mqtt_group.h"
+#include "../api/mqtt_client.h"
+#include "../api/mqtt_framer.h"
+
+/** Prefix of the shared subscription Topic Filter */
+#define SHARE_PREFIX          "$share/"
+/** Poll timeout in milliseconds */
+#define POLL_TIMEOUT          100
+/** Time in microseconds spent on the messages of one member before the worker serves the next one */
+#define DELIVER_SLICE         1000
+
+typedef struct {
+  /** Flags */
+  uint8_t flags;
+  /** Packet Identifier */
+  uint16_t id;
+  /** Length of the Topic Name */
+  size_t topic_len;
+  /** Length of the Properties */
+  size_t props_len;
+  /** Length of the Application Message */
+  size_t message_len;
+  /** Header of the message copied by the publish callback, followed by Topic Name, Properties and Application Message */
+} mqtt_group_msg_t;
+
+typedef struct {
+  /** Group the member belongs to */
+  mqtt_group_t *group;
+  /** Library client */
+  mqtt_client_t cli;
+  /** Set to 1 once the client is initialized */
+  uint8_t initialized;
+  /** Index of the member */
+  size_t index;
+  /** Socket connected to the broker, -1 if closed */
+  int sock;
+  /** Received data not processed yet */
+  uint8_t *in;
+  /** Number of bytes in the received data */
+  size_t in_len;
+  /** Decoder of the packet received partially */
+  mqtt_framer_t framer;
+  /** Data to send */
+  uint8_t *out;
+  /** Number of bytes in the data to send */
+  size_t out_len;
+  /** Buffer passed to the process() function */
+  uint8_t *io;
+  /** Messages copied by the publish callback and not passed to the user callback yet */
+  uint8_t *msgs;
+  /** Offset of the first message not passed to the user callback */
+  size_t msgs_off;
+  /** Number of bytes in the copied messages */
+  size_t msgs_len;
+  /** Statistics, protected by the library lock */
+  mqtt_group_stats_t stats;
+  /** Single group member */
+} mqtt_group_member_t;
+
+typedef struct {
+  /** Group the worker belongs to */
+  mqtt_group_t *group;
+  /** Index of the worker */
+  size_t index;
+  /** Worker thread */
+  pthread_t thread;
+  /** Set to 1 once the thread is started */
+  uint8_t started;
+  /** Single worker thread */
+} mqtt_group_worker_t;
+
+struct mqtt_group {
+  /** Group parameters, Share Name, Topic Filter and Client Identifier prefix are copied below */
+  mqtt_group_params_t params;
+  /** Shared subscription Topic Filter */
+  lv_t filter;
+  /** Client Identifier prefix */
+  char userid[MAX_USERID_LEN + 1];
+  /** Members */
+  mqtt_group_member_t *members;
+  /** Worker threads */
+  mqtt_group_worker_t *workers;
+  /** Number of the paused members, protected by the library lock */
+  size_t paused;
+  /** Set to 1 to stop the worker threads */
+  _Atomic int stop;
+};
+
+/** Library lock, process() of all clients uses the same static packet structures */
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief Fills the parameters of the shared subscription.
+ *
+ * @param group pointer to the group
+ * @param params pointer to SUBSCRIBE packet parameters
+ */
+static void __ATTR mqtt_group_subscribe_params(const mqtt_group_t *group, mqtt_subscribe_params_t *params) {
+  memset( params, 0x00, sizeof(mqtt_subscribe_params_t) );
+  params->filter.length = group->filter.length;
+  params->filter.value = group->filter.value;
+  params->filter.options = group->params.qos;
+}
+
+static mqtt_rc_t __ATTR mqtt_group_cb_connack(const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt, const mqtt_channel_t *channel) {
+  mqtt_group_member_t *member = (mqtt_group_member_t*) mqtt_client_user_data();
+  mqtt_subscribe_params_t params;
+
+  if(pkt->rc) {
+    return RC_SUCCESS;
+  }
+  member->stats.connected = 1;
+
+  mqtt_group_subscribe_params( member->group, &params );
+  self->subscribe( self, &params );
+
+  return RC_SUCCESS;
+}
+
+static void __ATTR mqtt_group_cb_suback(const mqtt_cli_ctx_cb_t *self, const mqtt_suback_t *pkt, const mqtt_channel_t *channel) {
+  mqtt_group_member_t *member = (mqtt_group_member_t*) mqtt_client_user_data();
+
+  member->stats.subscribed = (pkt->rc_len && pkt->rc[0] < 0x80);
+}
+
+static mqtt_rc_t __ATTR mqtt_group_cb_publish(const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt, const mqtt_channel_t *channel) {
+  mqtt_group_member_t *member = (mqtt_group_member_t*) mqtt_client_user_data();
+  mqtt_group_msg_t msg;
+  uint8_t *buf;
+
+  if(NULL == member->group->params.cb) {
+    ++member->stats.messages;
+    member->stats.bytes += pkt->message.length;
+    return RC_SUCCESS;
+  }
+
+  /* The user callback is called once the library lock is released, mqtt_group_reserve() made room for the whole packet */
+  msg.flags = pkt->flags;
+  msg.id = pkt->id;
+  msg.topic_len = pkt->topic.length;
+  msg.props_len = pkt->properties.length;
+  msg.message_len = pkt->message.length;
+  buf = member->msgs + member->msgs_len;
+  memcpy( buf, &msg, sizeof(msg) );
+  buf += sizeof(msg);
+  memcpy( buf, pkt->topic.value, msg.topic_len );
+  buf += msg.topic_len;
+  memcpy( buf, pkt->properties.value, msg.props_len );
+  buf += msg.props_len;
+  memcpy( buf, pkt->message.value, msg.message_len );
+  member->msgs_len += sizeof(msg) + msg.topic_len + msg.props_len + msg.message_len;
+
+  return RC_SUCCESS;
+}
+
+/**
+ * @brief Processes the data and appends all prepared packets to the member's outgoing data. Shall be called with the library lock held.
+ *
+ * @param member pointer to the member
+ * @param length number of bytes stored in the member's io buffer
+ *
+ * @returns the last process() return code
+ */
+static uint16_t __ATTR mqtt_group_process(mqtt_group_member_t *member, size_t length) {
+  clv_t data = { .capacity=member->group->params.params.bufsize, .length=length, .value=member->io };
+  uint16_t rc;
+
+  do {
+    rc = mqtt_client_process( &member->cli, &data, NULL );
+    /* The library has no callback of UNSUBACK, it returns 0 once the packet is consumed */
+    if(0 == rc) {
+      rc = MQTT_SUCCESS;
+    }
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      break;
+    }
+    if(data.length) {
+      if(member->out_len + data.length > member->group->params.sockbuf) {
+        return MQTT_OUT_OF_MEM;
+      }
+      memcpy( member->out + member->out_len, data.value, data.length );
+      member->out_len += data.length;
+    }
+    data.length = 0;
+  } while( rc == MQTT_PENDING_DATA );
+
+  return rc;
+}
+
+/**
+ * @brief Makes room for the messages of the next packet in the member's copied messages.
+ *
+ * @param member pointer to the member
+ *
+ * @returns 1 if the next packet could be processed, otherwise 0 until the copied messages are passed to the user callback
+ */
+static int __ATTR mqtt_group_reserve(mqtt_group_member_t *member) {
+  size_t capacity = member->group->params.sockbuf + sizeof(mqtt_group_msg_t);
+  size_t required = member->group->params.params.bufsize + sizeof(mqtt_group_msg_t);
+
+  if(member->msgs_off == member->msgs_len) {
+    member->msgs_off = member->msgs_len = 0;
+  }
+  if(capacity - member->msgs_len < required && member->msgs_off) {
+    memmove( member->msgs, member->msgs + member->msgs_off, member->msgs_len - member->msgs_off );
+    member->msgs_len -= member->msgs_off;
+    member->msgs_off = 0;
+  }
+
+  return capacity - member->msgs_len >= required;
+}
+
+/**
+ * @brief Processes the complete packets available in the received data as long as their messages could be copied.
+ *        Shall be called with the library lock held.
+ *
+ * @param member pointer to the member
+ *
+ * @returns MQTT_SUCCESS if all complete packets were processed,
+ *          MQTT_PENDING_DATA if some are left until the copied messages are passed to the callback,
+ *          otherwise the failed operation return code
+ */
+static uint16_t __ATTR mqtt_group_receive(mqtt_group_member_t *member) {
+  size_t offset = 0, length;
+  uint16_t rc, result = MQTT_SUCCESS;
+
+  while(1) {
+    if(!mqtt_group_reserve( member )) {
+      result = MQTT_PENDING_DATA;
+      break;
+    }
+    /* The packet started by the previous call is resumed, its header bytes are not decoded again */
+    rc = mqtt_framer_feed( &member->framer, member->in + offset, member->in_len - offset, &length );
+    if(MQTT_PENDING_DATA == rc) {
+      break;
+    }
+    if(MQTT_SUCCESS != rc) {
+      return rc;
+    }
+    memcpy( member->io, member->in + offset, length );
+    if( MQTT_SUCCESS != (rc = mqtt_group_process( member, length )) ) {
+      return rc;
+    }
+    offset += length;
+  }
+  memmove( member->in, member->in + offset, member->in_len - offset );
+  member->in_len -= offset;
+
+  return result;
+}
+
+/**
+ * @brief Passes the copied messages to the user callback until all are passed or the time slice of the member is used.
+ *        Shall be called without the library lock.
+ *
+ * @param member pointer to the member
+ * @param start pointer to the time the member's turn started
+ * @param messages pointer to the number of the messages passed, it is increased
+ * @param bytes pointer to the number of payload bytes passed, it is increased
+ */
+static void __ATTR mqtt_group_deliver(mqtt_group_member_t *member, const struct timespec *start, uint64_t *messages, uint64_t *bytes) {
+  mqtt_group_t *group = member->group;
+  mqtt_group_msg_t msg;
+  mqtt_publish_t pkt;
+  struct timespec now;
+  uint8_t *buf;
+
+  while(member->msgs_off < member->msgs_len) {
+    buf = member->msgs + member->msgs_off;
+    memcpy( &msg, buf, sizeof(msg) );
+    buf += sizeof(msg);
+    pkt.flags = msg.flags;
+    pkt.id = msg.id;
+    pkt.topic.length = msg.topic_len;
+    pkt.topic.value = buf;
+    pkt.properties.length = msg.props_len;
+    pkt.properties.value = buf + msg.topic_len;
+    pkt.message.length = msg.message_len;
+    pkt.message.value = buf + msg.topic_len + msg.props_len;
+    group->params.cb( group->params.arg, member->index, &pkt );
+    member->msgs_off += sizeof(msg) + msg.topic_len + msg.props_len + msg.message_len;
+    ++*messages;
+    *bytes += msg.message_len;
+
+    clock_gettime( CLOCK_MONOTONIC, &now );
+    if((now.tv_sec - start->tv_sec) * 1000000L + (now.tv_nsec - start->tv_nsec) / 1000 >= DELIVER_SLICE) {
+      break;
+    }
+  }
+}
+
+/**
+ * @brief Unsubscribes the member falling behind and subscribes it again once its lag is drained. Shall be called with the library lock held.
+ *
+ * @param member pointer to the member
+ *
+ * @returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t __ATTR mqtt_group_rebalance(mqtt_group_member_t *member) {
+  mqtt_group_t *group = member->group;
+  mqtt_subscribe_params_t subscribe;
+  mqtt_unsubscribe_params_t unsubscribe;
+  uint16_t rc;
+
+  if(!group->params.pause_backlog) {
+    return MQTT_SUCCESS;
+  }
+
+  /* The broker drops the messages if no member is subscribed */
+  if(!member->stats.paused && member->stats.subscribed && member->stats.lag > group->params.pause_backlog
+    && group->paused + 1 < group->params.members) {
+    memset( &unsubscribe, 0x00, sizeof(unsubscribe) );
+    unsubscribe.filter = group->filter;
+    if(MQTT_SUCCESS != (rc = mqtt_client_unsubscribe( &member->cli, &unsubscribe ))) {
+      return rc;
+    }
+    member->stats.paused = 1;
+    member->stats.subscribed = 0;
+    ++member->stats.pauses;
+    ++group->paused;
+    return mqtt_group_process( member, 0 );
+  }
+  if(member->stats.paused && member->stats.lag <= group->params.resume_backlog) {
+    mqtt_group_subscribe_params( group, &subscribe );
+    if(MQTT_SUCCESS != (rc = mqtt_client_subscribe( &member->cli, &subscribe ))) {
+      return rc;
+    }
+    member->stats.paused = 0;
+    --group->paused;
+    return mqtt_group_process( member, 0 );
+  }
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Serves the member: processes the received data, passes the messages to the user callback within the time slice
+ *        and rebalances the member according to the lag left for its next turn.
+ *
+ * @param member pointer to the member
+ * @param length number of bytes just received
+ * @param tick set to 1 if the empty packet shall be processed, which drives the keep alive
+ *
+ * @returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t __ATTR mqtt_group_turn(mqtt_group_member_t *member, size_t length, int tick) {
+  struct timespec start;
+  uint64_t messages = 0, bytes = 0;
+  int available = 0;
+  uint16_t rc = MQTT_SUCCESS;
+
+  clock_gettime( CLOCK_MONOTONIC, &start );
+  do {
+    if(length || member->in_len || tick) {
+      pthread_mutex_lock( &lock );
+      member->in_len += length;
+      rc = member->in_len ? mqtt_group_receive( member ) : mqtt_group_process( member, 0 );
+      pthread_mutex_unlock( &lock );
+      length = 0;
+      tick = 0;
+    }
+    if(rc != MQTT_SUCCESS && rc != MQTT_PENDING_DATA) {
+      break;
+    }
+    /* The user callback runs without the library lock, so the lag depends on the member's own processing only */
+    mqtt_group_deliver( member, &start, &messages, &bytes );
+    /* The packets left because the copied messages did not fit are processed within the same time slice */
+  } while(rc == MQTT_PENDING_DATA && member->msgs_off == member->msgs_len);
+
+  pthread_mutex_lock( &lock );
+  member->stats.messages += messages;
+  member->stats.bytes += bytes;
+  /* The data waiting in the socket grows while the worker serves the other members, it is not the member's lag */
+  member->stats.lag = member->msgs_len - member->msgs_off + member->in_len;
+  member->stats.backlog = member->stats.lag;
+  if(0 == ioctl( member->sock, FIONREAD, &available ) && available > 0) {
+    member->stats.backlog += available;
+  }
+  if(rc == MQTT_SUCCESS || rc == MQTT_PENDING_DATA) {
+    rc = mqtt_group_rebalance( member );
+  }
+  pthread_mutex_unlock( &lock );
+
+  return rc;
+}
+
+/**
+ * @brief Sends as much outgoing data as possible without blocking.
+ *
+ * @param member pointer to the member
+ *
+ * @returns 0 on success, otherwise -1
+ */
+static int __ATTR mqtt_group_flush(mqtt_group_member_t *member) {
+  ssize_t sent;
+
+  while(member->out_len) {
+    if( -1 == (sent = send( member->sock, member->out, member->out_len, MSG_NOSIGNAL )) ) {
+      return (errno == EAGAIN || errno == EWOULDBLOCK) ? 0 : -1;
+    }
+    memmove( member->out, member->out + sent, member->out_len - sent );
+    member->out_len -= sent;
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Closes the member's connection, the client is kept until the group is stopped.
+ *
+ * @param member pointer to the member
+ */
+static void __ATTR mqtt_group_close(mqtt_group_member_t *member) {
+  close( member->sock );
+  member->sock = -1;
+  member->in_len = 0;
+  member->out_len = 0;
+  member->msgs_off = member->msgs_len = 0;
+  mqtt_framer_init( &member->framer, member->group->params.params.bufsize );
+  pthread_mutex_lock( &lock );
+  member->stats.connected = 0;
+  member->stats.subscribed = 0;
+  member->stats.backlog = 0;
+  member->stats.lag = 0;
+  if(member->stats.paused) {
+    member->stats.paused = 0;
+    --member->group->paused;
+  }
+  pthread_mutex_unlock( &lock );
+}
+
+/**
+ * @brief Connects the member to the broker and prepares CONNECT packet.
+ *
+ * @param member pointer to the member
+ *
+ * @returns MQTT_SUCCESS on success, otherwise the failed operation return code
+ */
+static uint16_t __ATTR mqtt_group_open(mqtt_group_member_t *member) {
+  mqtt_group_t *group = member->group;
+  mqtt_params_t params = group->params.params;
+  struct sockaddr_in addr;
+  char id[MAX_USERID_LEN + 1];
+  lv_t userid;
+  int flag = 1;
+  uint16_t rc;
+
+  memset( &addr, 0x00, sizeof(addr) );
+  addr.sin_family = AF_INET;
+  addr.sin_addr.s_addr = group->params.ip;
+  addr.sin_port = htons( group->params.port );
+  if( -1 == (member->sock = socket( AF_INET, SOCK_STREAM, 0 )) ) {
+    return MQTT_NOT_CONNECTED;
+  }
+  if( 0 != connect( member->sock, (struct sockaddr*) &addr, sizeof(addr) ) ) {
+    close( member->sock );
+    member->sock = -1;
+    return MQTT_NOT_CONNECTED;
+  }
+  mqtt_framer_init( &member->framer, group->params.params.bufsize );
+  setsockopt( member->sock, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag) );
+  fcntl( member->sock, F_SETFL, fcntl( member->sock, F_GETFL, 0 ) | O_NONBLOCK );
+
+  pthread_mutex_lock( &lock );
+  if( MQTT_SUCCESS != (rc = mqtt_client_init( &member->cli, &params, member )) ) {
+    goto finish;
+  }
+  member->initialized = 1;
+  mqtt_client_set_cb_connack( &member->cli, mqtt_group_cb_connack );
+  mqtt_client_set_cb_suback( &member->cli, mqtt_group_cb_suback );
+  mqtt_client_set_cb_publish( &member->cli, mqtt_group_cb_publish );
+  userid.length = snprintf( id, sizeof(id), "%s%lu", group->userid, (unsigned long) member->index );
+  userid.value = (uint8_t*) id;
+  if(userid.length > MAX_USERID_LEN) {
+    rc = MQTT_INVALID_ARGS;
+    goto finish;
+  }
+  if( MQTT_SUCCESS != (rc = mqtt_client_set_br_userid( &member->cli, &userid )) ) {
+    goto finish;
+  }
+
+  /* CONNECT */
+  rc = mqtt_group_process( member, 0 );
+
+finish:
+  pthread_mutex_unlock( &lock );
+  if(rc == MQTT_SUCCESS && 0 != mqtt_group_flush( member )) {
+    rc = MQTT_NOT_CONNECTED;
+  }
+
+  return rc;
+}
+
+/**
+ * @brief Worker thread, handles every member whose index modulo the number of threads equals the worker's index.
+ *
+ * @param arg pointer to the worker
+ *
+ * @returns NULL
+ */
+static void * __ATTR mqtt_group_worker(void *arg) {
+  mqtt_group_worker_t *worker = (mqtt_group_worker_t*) arg;
+  mqtt_group_t *group = worker->group;
+  mqtt_group_member_t *member, **members;
+  struct pollfd *fds;
+  size_t i, count = 0;
+  ssize_t length;
+  time_t last = time( NULL ), now;
+  int timeout;
+  uint16_t rc;
+
+  members = calloc( group->params.members, sizeof(mqtt_group_member_t*) );
+  fds = calloc( group->params.members, sizeof(struct pollfd) );
+  if(NULL == members || NULL == fds) {
+    goto finish;
+  }
+  for(i=worker->index; i<group->params.members; i+=group->params.threads) {
+    members[count++] = &group->members[i];
+  }
+
+  while(!group->stop) {
+    timeout = POLL_TIMEOUT;
+    for(i=0; i<count; ++i) {
+      member = members[i];
+      if(member->sock >= 0 && 0 != mqtt_group_flush( member )) {
+        mqtt_group_close( member );
+      }
+      fds[i].fd = member->sock;
+      fds[i].events = (member->in_len < group->params.sockbuf ? POLLIN : 0) | (member->out_len ? POLLOUT : 0);
+      fds[i].revents = 0;
+      if(member->msgs_off < member->msgs_len) {
+        timeout = 0;
+      }
+    }
+    if(0 > poll( fds, count, timeout )) {
+      continue;
+    }
+
+    /* Empty packets drive the keep alive of each member once per second */
+    now = time( NULL );
+    for(i=0; i<count; ++i) {
+      member = members[i];
+      if(member->sock < 0) {
+        continue;
+      }
+      length = 0;
+      if((fds[i].revents & (POLLIN | POLLERR | POLLHUP)) && member->in_len < group->params.sockbuf) {
+        length = recv( member->sock, member->in + member->in_len, group->params.sockbuf - member->in_len, 0 );
+        if(0 == length || (-1 == length && errno != EAGAIN && errno != EWOULDBLOCK)) {
+          mqtt_group_close( member );
+          continue;
+        }
+      }
+      rc = mqtt_group_turn( member, (length > 0) ? (size_t) length : 0, now != last );
+      if(rc != MQTT_SUCCESS && rc != MQTT_NOT_CONNECTED) {
+        mqtt_group_close( member );
+      }
+    }
+    last = now;
+  }
+
+finish:
+  free( members );
+  free( fds );
+
+  return NULL;
+}
+
+uint16_t __ATTR mqtt_group_start(mqtt_group_t **group, const mqtt_group_params_t *params) {
+  mqtt_group_t *obj;
+  mqtt_group_member_t *member;
+  size_t i, length;
+  uint16_t rc = MQTT_OUT_OF_MEM;
+
+  if(NULL == group || NULL == params || !params->members || params->members > MQTT_GROUP_MAX_MEMBERS
+    || !params->threads || params->threads > params->members
+    || !params->share_name.length || params->share_name.length > MQTT_GROUP_MAX_NAME_LEN
+    || !params->filter.length || params->userid.length > MAX_USERID_LEN
+    || params->sockbuf < params->params.bufsize || params->qos > MAX_QOS
+    || (params->pause_backlog && params->resume_backlog >= params->pause_backlog)) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(NULL == (obj = calloc( 1, sizeof(mqtt_group_t) ))) {
+    return MQTT_OUT_OF_MEM;
+  }
+  obj->params = *params;
+  memcpy( obj->userid, params->userid.value, params->userid.length );
+
+  /* $share/{ShareName}/{filter} */
+  length = sizeof(SHARE_PREFIX) - 1 + params->share_name.length + 1 + params->filter.length;
+  obj->members = calloc( params->members, sizeof(mqtt_group_member_t) );
+  obj->workers = calloc( params->threads, sizeof(mqtt_group_worker_t) );
+  if(NULL == obj->members || NULL == obj->workers || NULL == (obj->filter.value = malloc( length ))) {
+    goto finish;
+  }
+  memcpy( obj->filter.value, SHARE_PREFIX, sizeof(SHARE_PREFIX) - 1 );
+  obj->filter.length = sizeof(SHARE_PREFIX) - 1;
+  memcpy( obj->filter.value + obj->filter.length, params->share_name.value, params->share_name.length );
+  obj->filter.length += params->share_name.length;
+  obj->filter.value[obj->filter.length++] = '/';
+  memcpy( obj->filter.value + obj->filter.length, params->filter.value, params->filter.length );
+  obj->filter.length += params->filter.length;
+
+  for(i=0; i<params->members; ++i) {
+    member = &obj->members[i];
+    member->group = obj;
+    member->index = i;
+    member->sock = -1;
+    if(NULL == (member->in = malloc( 3 * params->sockbuf + sizeof(mqtt_group_msg_t) + params->params.bufsize ))) {
+      rc = MQTT_OUT_OF_MEM;
+      goto finish;
+    }
+    member->out = member->in + params->sockbuf;
+    member->msgs = member->out + params->sockbuf;
+    member->io = member->msgs + params->sockbuf + sizeof(mqtt_group_msg_t);
+    if(MQTT_SUCCESS != (rc = mqtt_group_open( member ))) {
+      goto finish;
+    }
+  }
+
+  for(i=0; i<params->threads; ++i) {
+    obj->workers[i].group = obj;
+    obj->workers[i].index = i;
+    if(0 != pthread_create( &obj->workers[i].thread, NULL, mqtt_group_worker, &obj->workers[i] )) {
+      rc = MQTT_OUT_OF_MEM;
+      goto finish;
+    }
+    obj->workers[i].started = 1;
+  }
+  rc = MQTT_SUCCESS;
+
+finish:
+  if(rc != MQTT_SUCCESS) {
+    mqtt_group_stop( obj );
+    obj = NULL;
+  }
+  *group = obj;
+
+  return rc;
+}
+
+size_t __ATTR mqtt_group_stats(mqtt_group_t *group, mqtt_group_stats_t *stats) {
+  size_t i, connected = 0;
+
+  pthread_mutex_lock( &lock );
+  for(i=0; i<group->params.members; ++i) {
+    stats[i] = group->members[i].stats;
+    connected += stats[i].connected;
+  }
+  pthread_mutex_unlock( &lock );
+
+  return connected;
+}
+
+void __ATTR mqtt_group_stop(mqtt_group_t *group) {
+  mqtt_group_member_t *member;
+  size_t i;
+
+  if(NULL == group) {
+    return;
+  }
+  group->stop = 1;
+  for(i=0; NULL != group->workers && i<group->params.threads; ++i) {
+    if(group->workers[i].started) {
+      pthread_join( group->workers[i].thread, NULL );
+    }
+  }
+
+  for(i=0; NULL != group->members && i<group->params.members; ++i) {
+    member = &group->members[i];
+    pthread_mutex_lock( &lock );
+    if(member->sock >= 0 && member->initialized) {
+      mqtt_client_disconnect( &member->cli );
+      mqtt_group_process( member, 0 );
+    }
+    if(member->initialized) {
+      mqtt_client_destr( &member->cli );
+    }
+    pthread_mutex_unlock( &lock );
+    if(member->sock >= 0) {
+      mqtt_group_flush( member );
+      close( member->sock );
+    }
+    free( member->in );
+  }
+
+  free( group->members );
+  free( group->workers );
+  free( group->filter.value );
+  free( group );
+}
+
+void __ATTR mqtt_group_lock(void) {
+  pthread_mutex_lock( &lock );
+}
+
+void __ATTR mqtt_group_unlock(void) {
+  pthread_mutex_unlock( &lock );
+}
@@ -0,0 +1,303 @@
+#include <string.h>
+
+#include "../api/mqtt_json.h"
+
+/**
+ * Escape of each byte: 0 - copied as is, 'u' - written as \u00XX, otherwise written as backslash and the character.
+ * Computed once, so the string is copied without any comparisons of the single characters.
+ */
+static const uint8_t escapes[256] = {
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'b', 't', 'n', 'u', 'f', 'r', 'u', 'u',
+  'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u', 'u',
+    0,   0, '"',   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+    0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,'\\',   0,   0,   0,
+};
+
+static const char hex[] = "0123456789abcdef";
+
+/**
+ * @brief Reserves the space in the output buffer.
+ *
+ * @param json pointer to the writer
+ * @param len number of the bytes to write
+ *
+ * @returns pointer to the reserved space or NULL if the output is full or an error occurred before
+ */
+static uint8_t* __ATTR mqtt_json_reserve(mqtt_json_t *json, size_t len) {
+  uint8_t *ptr;
+
+  if(MQTT_SUCCESS != json->rc) {
+    return NULL;
+  }
+  if(json->out->capacity - json->out->length < len) {
+    json->rc = MQTT_OUT_OF_MEM;
+    return NULL;
+  }
+  ptr = json->out->value + json->out->length;
+  json->out->length += len;
+
+  return ptr;
+}
+
+/**
+ * @brief Writes the separator preceding the value, i.e. the comma if the value is not the first one.
+ *
+ * @param json pointer to the writer
+ *
+ * @returns 1 if the value could be written, otherwise 0
+ */
+static uint8_t __ATTR mqtt_json_value(mqtt_json_t *json) {
+  uint8_t *ptr;
+
+  if(MQTT_SUCCESS != json->rc) {
+    return 0;
+  }
+  if(json->key) {
+    /* Key already wrote the separator */
+    json->key = 0;
+    return 1;
+  }
+  if(json->depth && (json->members & (1 << (json->depth - 1)))) {
+    if(NULL == (ptr = mqtt_json_reserve( json, 1 ))) {
+      return 0;
+    }
+    *ptr = ',';
+  }
+  if(json->depth) {
+    json->members |= (1 << (json->depth - 1));
+  }
+
+  return 1;
+}
+
+/**
+ * @brief Appends the bytes.
+ *
+ * @param json pointer to the writer
+ * @param buf pointer to the bytes
+ * @param len number of the bytes
+ */
+static void __ATTR mqtt_json_write(mqtt_json_t *json, const void *buf, size_t len) {
+  uint8_t *ptr;
+
+  if(NULL != (ptr = mqtt_json_reserve( json, len ))) {
+    memcpy( ptr, buf, len );
+  }
+}
+
+/**
+ * @brief Appends the escaped characters, without the quotes.
+ *
+ * @param json pointer to the writer
+ * @param value pointer to the characters
+ * @param len number of the bytes
+ */
+static void __ATTR mqtt_json_escape(mqtt_json_t *json, const uint8_t *value, size_t len) {
+  const uint8_t *end = value + len, *run;
+  uint8_t *ptr, esc;
+
+  while(value < end) {
+    /* Longest run without escapes is copied at once */
+    for(run=value; run < end && !escapes[*run]; ++run) { }
+    if(run > value) {
+      mqtt_json_write( json, value, run - value );
+      value = run;
+      continue;
+    }
+    esc = escapes[*value];
+    if('u' == esc) {
+      if(NULL == (ptr = mqtt_json_reserve( json, 6 ))) {
+        return;
+      }
+      memcpy( ptr, "\\u00", 4 );
+      ptr[4] = hex[*value >> 4];
+      ptr[5] = hex[*value & 0x0F];
+    } else {
+      if(NULL == (ptr = mqtt_json_reserve( json, 2 ))) {
+        return;
+      }
+      ptr[0] = '\\';
+      ptr[1] = esc;
+    }
+    ++value;
+  }
+}
+
+/**
+ * @brief Opens the object or array.
+ *
+ * @param json pointer to the writer
+ * @param c opening character
+ */
+static void __ATTR mqtt_json_open(mqtt_json_t *json, char c) {
+  if(!mqtt_json_value( json )) {
+    return;
+  }
+  if(json->depth >= MQTT_JSON_MAX_DEPTH) {
+    json->rc = MQTT_INVALID_STATE;
+    return;
+  }
+  mqtt_json_write( json, &c, 1 );
+  json->members &= ~(1 << json->depth);
+  if('[' == c) {
+    json->arrays |= (1 << json->depth);
+  } else {
+    json->arrays &= ~(1 << json->depth);
+  }
+  ++json->depth;
+}
+
+void __ATTR mqtt_json_init(mqtt_json_t *json, clv_t *out) {
+  memset( json, 0x00, sizeof(mqtt_json_t) );
+  json->out = out;
+  json->start = out->length;
+  json->rc = MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_json_object(mqtt_json_t *json) {
+  mqtt_json_open( json, '{' );
+}
+
+void __ATTR mqtt_json_array(mqtt_json_t *json) {
+  mqtt_json_open( json, '[' );
+}
+
+void __ATTR mqtt_json_close(mqtt_json_t *json) {
+  uint8_t *ptr;
+
+  if(MQTT_SUCCESS != json->rc) {
+    return;
+  }
+  if(!json->depth || json->key) {
+    json->rc = MQTT_INVALID_STATE;
+    return;
+  }
+  if(NULL == (ptr = mqtt_json_reserve( json, 1 ))) {
+    return;
+  }
+  --json->depth;
+  *ptr = (json->arrays & (1 << json->depth)) ? ']' : '}';
+}
+
+void __ATTR mqtt_json_key(mqtt_json_t *json, const char *key) {
+  size_t len = strlen( key );
+  uint16_t bit;
+  uint8_t *ptr, comma;
+
+  if(MQTT_SUCCESS != json->rc) {
+    return;
+  }
+  if(json->key || !json->depth || (json->arrays & (1 << (json->depth - 1)))) {
+    /* Key shall be a member of the object */
+    json->rc = MQTT_INVALID_STATE;
+    return;
+  }
+  /* Separator, quotes and colon are reserved together with the key */
+  bit = 1 << (json->depth - 1);
+  comma = (json->members & bit) ? 1 : 0;
+  if(NULL == (ptr = mqtt_json_reserve( json, comma + len + 3 ))) {
+    return;
+  }
+  json->members |= bit;
+  if(comma) {
+    *ptr++ = ',';
+  }
+  *ptr++ = '"';
+  memcpy( ptr, key, len );
+  ptr += len;
+  *ptr++ = '"';
+  *ptr = ':';
+  json->key = 1;
+}
+
+void __ATTR mqtt_json_string(mqtt_json_t *json, const char *value, size_t len) {
+  lv_t part = { .length = len, .value = (uint8_t*) value };
+
+  mqtt_json_string_ex( json, &part, 1 );
+}
+
+void __ATTR mqtt_json_string_ex(mqtt_json_t *json, const lv_t *parts, size_t count) {
+  const uint8_t *run, *end;
+  size_t i, len = 0;
+  uint8_t *ptr;
+
+  if(!mqtt_json_value( json )) {
+    return;
+  }
+  for(i=0; i < count; ++i) {
+    end = parts[i].value + parts[i].length;
+    for(run=parts[i].value; run < end && !escapes[*run]; ++run) { }
+    if(run != end) {
+      break;
+    }
+    len += parts[i].length;
+  }
+  if(i == count) {
+    /* Usual case, nothing to escape: the string and its quotes are written at once */
+    if(NULL != (ptr = mqtt_json_reserve( json, len + 2 ))) {
+      *ptr++ = '"';
+      for(i=0; i < count; ++i) {
+        memcpy( ptr, parts[i].value, parts[i].length );
+        ptr += parts[i].length;
+      }
+      *ptr = '"';
+    }
+    return;
+  }
+  if(NULL == (ptr = mqtt_json_reserve( json, 1 ))) {
+    return;
+  }
+  *ptr = '"';
+  for(i=0; i < count; ++i) {
+    mqtt_json_escape( json, parts[i].value, parts[i].length );
+  }
+  if(NULL != (ptr = mqtt_json_reserve( json, 1 ))) {
+    *ptr = '"';
+  }
+}
+
+void __ATTR mqtt_json_int(mqtt_json_t *json, int32_t value) {
+  char digits[11], *ptr = digits + sizeof(digits);
+  uint32_t num = (value < 0) ? 0u - (uint32_t) value : (uint32_t) value;
+
+  if(!mqtt_json_value( json )) {
+    return;
+  }
+  do {
+    *--ptr = '0' + (num % 10);
+    num /= 10;
+  } while(num);
+  if(value < 0) {
+    *--ptr = '-';
+  }
+  mqtt_json_write( json, ptr, digits + sizeof(digits) - ptr );
+}
+
+void __ATTR mqtt_json_bool(mqtt_json_t *json, uint8_t value) {
+  if(mqtt_json_value( json )) {
+    if(value) {
+      mqtt_json_write( json, "true", 4 );
+    } else {
+      mqtt_json_write( json, "false", 5 );
+    }
+  }
+}
+
+void __ATTR mqtt_json_null(mqtt_json_t *json) {
+  if(mqtt_json_value( json )) {
+    mqtt_json_write( json, "null", 4 );
+  }
+}
+
+uint16_t __ATTR mqtt_json_end(mqtt_json_t *json) {
+  if(MQTT_SUCCESS == json->rc && (json->depth || json->key)) {
+    json->rc = MQTT_INVALID_STATE;
+  }
+  if(MQTT_SUCCESS != json->rc) {
+    json->out->length = json->start;
+  }
+
+  return json->rc;
+}
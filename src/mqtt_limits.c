@@ -0,0 +1,98 @@
+#include <string.h>
+
+#include "../api/mqtt_limits.h"
+#include "../api/mqtt_util.h"
+
+/** Maximum Packet Size property */
+#define PROP_MAX_PACKET_SIZE  0x27
+/** User Property */
+#define PROP_USER_PROPERTY    0x26
+
+/**
+ * @brief Calculates number of bytes used to encode the Variable Byte Integer.
+ *
+ * @param value value to encode
+ *
+ * @returns number of bytes
+ */
+static size_t __ATTR mqtt_limits_varint_size(size_t value) {
+  return value < 128 ? 1 : value < 16384 ? 2 : value < 2097152 ? 3 : 4;
+}
+
+void __ATTR mqtt_limits_init(mqtt_limits_t *limits, uint8_t version) {
+  memset( limits, 0x00, sizeof(mqtt_limits_t) );
+  limits->version = version;
+}
+
+void __ATTR mqtt_limits_connack(mqtt_limits_t *limits, const mqtt_cli_ctx_cb_t *self, const mqtt_connack_t *pkt) {
+  size_t offset = 0, used = 0, length;
+  const uint8_t *buf;
+
+  limits->max_packet_size = 0;
+  if(limits->version >= 5 && pkt->properties.length) {
+    length = pkt->properties.length;
+    self->find_property( PROP_MAX_PACKET_SIZE, pkt->properties.value, &offset, &used, &length );
+    if(length == 4) {
+      buf = pkt->properties.value + offset + 1 + used;
+      limits->max_packet_size = ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | buf[3];
+    }
+  }
+}
+
+size_t __ATTR mqtt_limits_publish_size(const mqtt_limits_t *limits, const mqtt_publish_params_t *params) {
+  size_t remaining, properties_len;
+
+  /* Topic Name, Packet Identifier for QoS > 0 and Payload */
+  remaining = 2 + params->topic.length + ((params->flags & 0x06) ? 2 : 0) + params->message.length;
+  if(limits->version >= 5) {
+    properties_len = params->properties.value ? params->properties.length : 0;
+    remaining += mqtt_limits_varint_size( properties_len ) + properties_len;
+  }
+
+  return 1 + mqtt_limits_varint_size( remaining ) + remaining;
+}
+
+uint16_t __ATTR mqtt_limits_fit(const mqtt_limits_t *limits, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity) {
+  mqtt_publish_params_t shed_params;
+  const uint8_t *properties;
+  size_t offset, size, length, shed;
+
+  if(!limits->max_packet_size || mqtt_limits_publish_size( limits, params ) <= limits->max_packet_size) {
+    return MQTT_SUCCESS;
+  }
+  if(limits->version < 5 || NULL == params->properties.value) {
+    return MQTT_PKT_TOO_LARGE;
+  }
+
+  /* Calculating the size of the User Properties before copying anything */
+  properties = params->properties.value;
+  shed = 0;
+  for(offset=0; offset<params->properties.length; offset+=size) {
+    if(!(size = mqtt_util_property_size( properties + offset, params->properties.length - offset ))) {
+      return MQTT_INVALID_ARGS;
+    }
+    if(properties[offset] == PROP_USER_PROPERTY) {
+      shed += size;
+    }
+  }
+  shed_params = *params;
+  shed_params.properties.length -= shed;
+  if(!shed || NULL == buf || shed_params.properties.length > capacity
+    || mqtt_limits_publish_size( limits, &shed_params ) > limits->max_packet_size) {
+    return MQTT_PKT_TOO_LARGE;
+  }
+
+  /* Copying the rest of the properties */
+  length = 0;
+  for(offset=0; offset<params->properties.length; offset+=size) {
+    size = mqtt_util_property_size( properties + offset, params->properties.length - offset );
+    if(properties[offset] != PROP_USER_PROPERTY) {
+      memcpy( buf + length, properties + offset, size );
+      length += size;
+    }
+  }
+  params->properties.value = length ? buf : NULL;
+  params->properties.length = length;
+
+  return MQTT_SUCCESS;
+}
@@ -0,0 +1,182 @@
+#include <string.h>
+
+#include "../api/mqtt_lvc.h"
+#include "../api/mqtt_util.h"
+
+/** RETAIN flag of PUBLISH packet */
+#define FLAG_RETAIN   0x01
+
+/**
+ * @brief Advances the slot index, wrapping around without the division.
+ *
+ * @param lvc pointer to the cache
+ * @param idx index of the slot
+ *
+ * @returns index of the next slot
+ */
+static size_t __ATTR mqtt_lvc_next(const mqtt_lvc_t *lvc, size_t idx) {
+  return (++idx == lvc->count) ? 0 : idx;
+}
+
+/**
+ * @brief Finds the slot of the Topic Name.
+ *
+ * @param lvc pointer to the cache
+ * @param hash hash of the Topic Name
+ * @param topic pointer to the Topic Name
+ * @param idx pointer to the index of the found slot or of the free slot ending the search
+ *
+ * @returns 1 if the Topic Name was found, otherwise 0
+ */
+static uint8_t __ATTR mqtt_lvc_find(const mqtt_lvc_t *lvc, uint32_t hash, const lv_t *topic, size_t *idx) {
+  const mqtt_lvc_slot_t *slot;
+  size_t i;
+
+  /* Linear probing, at least a quarter of the slots is free so the search always ends */
+  for(i=hash % lvc->count; ; i=mqtt_lvc_next( lvc, i )) {
+    slot = &lvc->slots[i];
+    if(!slot->used) {
+      *idx = i;
+      return 0;
+    }
+    if(slot->hash == hash && slot->topic_len == topic->length
+      && !memcmp( lvc->value + i * lvc->slot_size, topic->value, topic->length )) {
+      *idx = i;
+      return 1;
+    }
+  }
+}
+
+/**
+ * @brief Releases the slot and shifts the following entries back, so no deleted markers are needed.
+ *
+ * @param lvc pointer to the cache
+ * @param idx index of the slot
+ */
+static void __ATTR mqtt_lvc_release(mqtt_lvc_t *lvc, size_t idx) {
+  mqtt_lvc_slot_t *slot;
+  size_t next, home;
+
+  for(next=mqtt_lvc_next( lvc, idx ); lvc->slots[next].used; next=mqtt_lvc_next( lvc, next )) {
+    /* The entry stays if its home slot lies cyclically within (idx, next] */
+    slot = &lvc->slots[next];
+    home = slot->hash % lvc->count;
+    if(idx <= next ? (idx < home && home <= next) : (idx < home || home <= next)) {
+      continue;
+    }
+    lvc->slots[idx] = *slot;
+    memcpy( lvc->value + idx * lvc->slot_size, lvc->value + next * lvc->slot_size, slot->topic_len + slot->message_len );
+    idx = next;
+  }
+  lvc->slots[idx].used = 0;
+  --lvc->length;
+}
+
+/**
+ * @brief Evicts the first entry not referenced since the hand passed it last time.
+ *
+ * @param lvc pointer to the cache
+ */
+static void __ATTR mqtt_lvc_evict(mqtt_lvc_t *lvc) {
+  mqtt_lvc_slot_t *slot;
+  size_t victim;
+
+  /* The hand clears the references, so it stops within two sweeps */
+  for( ; ; lvc->hand=mqtt_lvc_next( lvc, lvc->hand )) {
+    slot = &lvc->slots[lvc->hand];
+    if(!slot->used) {
+      continue;
+    }
+    if(!slot->referenced) {
+      break;
+    }
+    slot->referenced = 0;
+  }
+  victim = lvc->hand;
+  lvc->hand = mqtt_lvc_next( lvc, lvc->hand );
+  mqtt_lvc_release( lvc, victim );
+  ++lvc->evicted;
+}
+
+void __ATTR mqtt_lvc_init(mqtt_lvc_t *lvc, mqtt_lvc_slot_t *slots, size_t count, uint8_t *buf, size_t slot_size) {
+  memset( lvc, 0x00, sizeof(mqtt_lvc_t) );
+  memset( slots, 0x00, count * sizeof(mqtt_lvc_slot_t) );
+  lvc->slots = slots;
+  lvc->count = count;
+  lvc->value = buf;
+  lvc->slot_size = slot_size;
+  lvc->capacity = count - (count + 3) / 4;
+}
+
+uint16_t __ATTR mqtt_lvc_update(mqtt_lvc_t *lvc, const mqtt_publish_t *pkt) {
+  mqtt_lvc_slot_t *slot;
+  uint32_t hash;
+  size_t idx;
+  uint8_t found;
+
+  if(NULL == lvc || NULL == pkt || lvc->count < 2 || !pkt->topic.length || NULL == pkt->topic.value
+    || pkt->topic.length > MAX_TOPIC_LEN || pkt->message.length > MAX_MESSAGE_LEN || (pkt->message.length && NULL == pkt->message.value)) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  hash = mqtt_util_hash( pkt->topic.value, pkt->topic.length );
+  found = mqtt_lvc_find( lvc, hash, &pkt->topic, &idx );
+  if((pkt->flags & FLAG_RETAIN) && !pkt->message.length) {
+    if(found) {
+      mqtt_lvc_release( lvc, idx );
+    }
+    return MQTT_SUCCESS;
+  }
+  if(pkt->topic.length + pkt->message.length > lvc->slot_size) {
+    if(found) {
+      mqtt_lvc_release( lvc, idx );
+    }
+    return MQTT_OUT_OF_MEM;
+  }
+
+  slot = &lvc->slots[idx];
+  if(!found) {
+    if(lvc->length >= lvc->capacity) {
+      /* Entries could be shifted by the eviction, the free slot is searched again */
+      mqtt_lvc_evict( lvc );
+      mqtt_lvc_find( lvc, hash, &pkt->topic, &idx );
+      slot = &lvc->slots[idx];
+    }
+    slot->used = 1;
+    slot->hash = hash;
+    slot->topic_len = (uint16_t) pkt->topic.length;
+    slot->referenced = 1;
+    memcpy( lvc->value + idx * lvc->slot_size, pkt->topic.value, pkt->topic.length );
+    ++lvc->length;
+  }
+
+  /* Topic Name is already stored, only the message is replaced */
+  if(pkt->message.length) {
+    memcpy( lvc->value + idx * lvc->slot_size + slot->topic_len, pkt->message.value, pkt->message.length );
+  }
+  slot->message_len = (uint16_t) pkt->message.length;
+  slot->flags = pkt->flags;
+
+  return MQTT_SUCCESS;
+}
+
+uint8_t __ATTR mqtt_lvc_get(mqtt_lvc_t *lvc, const lv_t *topic, lv_t *message) {
+  size_t idx;
+
+  if(!lvc->length || !mqtt_lvc_find( lvc, mqtt_util_hash( topic->value, topic->length ), topic, &idx )) {
+    return 0;
+  }
+  lvc->slots[idx].referenced = 1;
+  message->length = lvc->slots[idx].message_len;
+  message->value = lvc->value + idx * lvc->slot_size + lvc->slots[idx].topic_len;
+
+  return 1;
+}
+
+void __ATTR mqtt_lvc_remove(mqtt_lvc_t *lvc, const lv_t *topic) {
+  size_t idx;
+
+  if(lvc->length && mqtt_lvc_find( lvc, mqtt_util_hash( topic->value, topic->length ), topic, &idx )) {
+    mqtt_lvc_release( lvc, idx );
+  }
+}
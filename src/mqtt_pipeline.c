@@ -0,0 +1,106 @@
+#include <string.h>
+
+#include "../api/mqtt_pipeline.h"
+#include "../api/mqtt_topic.h"
+
+/**
+ * @brief Encodes the Variable Byte Integer.
+ *
+ * @param buf pointer to the buffer
+ * @param value value to encode
+ *
+ * @returns number of bytes used
+ */
+static size_t __ATTR mqtt_pipeline_encode_size(uint8_t *buf, size_t value) {
+  size_t used = 0;
+
+  do {
+    buf[used] = (uint8_t) (value & 0x7F);
+    value >>= 7;
+    if(value) {
+      buf[used] |= 0x80;
+    }
+    ++used;
+  } while(value);
+
+  return used;
+}
+
+void __ATTR mqtt_pipeline_init(mqtt_pipeline_t *pipeline, uint8_t version, uint8_t *buf, size_t capacity) {
+  memset( pipeline, 0x00, sizeof(mqtt_pipeline_t) );
+  pipeline->value = buf;
+  pipeline->capacity = capacity;
+  pipeline->version = version;
+}
+
+uint16_t __ATTR mqtt_pipeline_publish(mqtt_pipeline_t *pipeline, const mqtt_publish_params_t *params) {
+  uint8_t header[16];
+  size_t offset = 0, props_used = 0, props_len = 0, remaining;
+  uint8_t *buf;
+
+  if(NULL == pipeline || NULL == params || MQTT_SUCCESS != mqtt_topic_validate_name( &params->topic )) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(params->message.length > MAX_MESSAGE_LEN || (params->message.length && NULL == params->message.value)) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(params->flags & 0x06) {
+    return MQTT_NOT_SUPPORTED;
+  }
+
+  remaining = 2 + params->topic.length + params->message.length;
+  if(pipeline->version >= 5) {
+    props_len = params->properties.value ? params->properties.length : 0;
+    if(props_len > MAX_PROPERTIES_LEN) {
+      return MQTT_INVALID_ARGS;
+    }
+    props_used = mqtt_pipeline_encode_size( header + 8, props_len );
+    remaining += props_used + props_len;
+  }
+  header[offset++] = (uint8_t) (0x30 | (params->flags & 0x0F));
+  offset += mqtt_pipeline_encode_size( header + offset, remaining );
+
+  if(pipeline->length + offset + remaining > pipeline->capacity) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  buf = pipeline->value + pipeline->length;
+  memcpy( buf, header, offset );
+  buf += offset;
+  *buf++ = (uint8_t) (params->topic.length >> 8);
+  *buf++ = (uint8_t) (params->topic.length);
+  memcpy( buf, params->topic.value, params->topic.length );
+  buf += params->topic.length;
+  if(pipeline->version >= 5) {
+    memcpy( buf, header + 8, props_used );
+    buf += props_used;
+    if(props_len) {
+      memcpy( buf, params->properties.value, props_len );
+      buf += props_len;
+    }
+  }
+  if(params->message.length) {
+    memcpy( buf, params->message.value, params->message.length );
+  }
+  pipeline->length += offset + remaining;
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_pipeline_get(mqtt_pipeline_t *pipeline, const clv_t *data, lv_t *packets) {
+  packets->length = 0;
+  packets->value = pipeline->value;
+
+  /* Queued packets shall directly follow CONNECT */
+  if(data->length && (data->value[0] >> 4) == PTYPE_CONNECT && pipeline->length) {
+    packets->length = pipeline->length;
+    pipeline->sent = pipeline->length;
+  }
+}
+
+void __ATTR mqtt_pipeline_commit(mqtt_pipeline_t *pipeline) {
+  /* Keep packets queued after the last CONNECT */
+  memmove( pipeline->value, pipeline->value + pipeline->sent, pipeline->length - pipeline->sent );
+  pipeline->length -= pipeline->sent;
+  pipeline->sent = 0;
+}
@@ -0,0 +1,205 @@
+#include <string.h>
+
+#include "../api/mqtt_queue.h"
+#include "../api/mqtt_util.h"
+
+/** Slot was never used */
+#define SLOT_EMPTY    0
+/** Slot stores the message */
+#define SLOT_USED     1
+/** Slot was released, searching shall continue */
+#define SLOT_DELETED  2
+
+/** Message Expiry Interval property */
+#define PROP_MESSAGE_EXPIRY   0x02
+
+/**
+ * @brief Finds Message Expiry Interval within PUBLISH properties.
+ *
+ * @param buf pointer to the properties
+ * @param len length of the properties
+ * @param offset pointer to the offset of the property value increased by 1, 0 if the property was not found
+ *
+ * @returns MQTT_SUCCESS if the properties were parsed, otherwise MQTT_INVALID_ARGS
+ */
+static uint16_t __ATTR mqtt_queue_find_expiry(const uint8_t *buf, size_t len, uint8_t *offset) {
+  size_t i, size;
+
+  *offset = 0;
+  for(i=0; i<len; i+=size) {
+    if(!(size = mqtt_util_property_size( buf + i, len - i ))) {
+      return MQTT_INVALID_ARGS;
+    }
+    if(buf[i] == PROP_MESSAGE_EXPIRY) {
+      /* The value follows the identifier */
+      *offset = (uint8_t) (i + 2);
+    }
+  }
+
+  return MQTT_SUCCESS;
+}
+
+/**
+ * @brief Releases the slot.
+ *
+ * @param queue pointer to the queue
+ * @param idx index of the slot
+ */
+static void __ATTR mqtt_queue_release(mqtt_queue_t *queue, size_t idx) {
+  queue->slots[idx].state = SLOT_DELETED;
+  /* Releasing deleted slots if the queue is empty */
+  if(!--queue->length) {
+    memset( queue->slots, 0x00, queue->count * sizeof(mqtt_queue_slot_t) );
+  }
+}
+
+void __ATTR mqtt_queue_init(mqtt_queue_t *queue, uint8_t mode, mqtt_queue_slot_t *slots, size_t count, uint8_t *buf, size_t slot_size) {
+  memset( queue, 0x00, sizeof(mqtt_queue_t) );
+  memset( slots, 0x00, count * sizeof(mqtt_queue_slot_t) );
+  queue->slots = slots;
+  queue->count = count;
+  queue->value = buf;
+  queue->slot_size = slot_size;
+  queue->mode = mode;
+}
+
+uint16_t __ATTR mqtt_queue_push(mqtt_queue_t *queue, const mqtt_publish_params_t *params, uint32_t now) {
+  return mqtt_queue_push_ex( queue, params, MQTT_QUEUE_LANE_BULK, now );
+}
+
+uint16_t __ATTR mqtt_queue_push_ex(mqtt_queue_t *queue, const mqtt_publish_params_t *params, uint8_t lane, uint32_t now) {
+  mqtt_queue_slot_t *slot = NULL;
+  size_t i, idx, free_idx, properties_len;
+  uint32_t hash;
+  uint8_t *buf, expiry_offset;
+
+  if(NULL == queue || NULL == params || !queue->count || lane >= MQTT_QUEUE_LANES || !params->topic.length || NULL == params->topic.value
+    || (params->message.length && NULL == params->message.value)) {
+    return MQTT_INVALID_ARGS;
+  }
+  properties_len = params->properties.value ? params->properties.length : 0;
+  if(params->topic.length > MAX_TOPIC_LEN || params->message.length > MAX_MESSAGE_LEN || properties_len > MAX_PROPERTIES_LEN) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(MQTT_SUCCESS != mqtt_queue_find_expiry( params->properties.value, properties_len, &expiry_offset )) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(params->topic.length + properties_len + params->message.length > queue->slot_size) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  /* Linear probing starting from the slot selected by the hash */
+  hash = mqtt_util_hash( params->topic.value, params->topic.length );
+  free_idx = queue->count;
+  for(i=0; i<queue->count; ++i) {
+    idx = (hash + i) % queue->count;
+    if(queue->slots[idx].state == SLOT_EMPTY) {
+      if(free_idx == queue->count) {
+        free_idx = idx;
+      }
+      break;
+    }
+    else if(queue->slots[idx].state == SLOT_DELETED) {
+      if(free_idx == queue->count) {
+        free_idx = idx;
+      }
+    }
+    else if(queue->mode == MQTT_QUEUE_LAST_VALUE && queue->slots[idx].hash == hash && queue->slots[idx].topic_len == params->topic.length
+      && !memcmp( queue->value + idx * queue->slot_size, params->topic.value, params->topic.length )) {
+      slot = &queue->slots[idx];
+      break;
+    }
+  }
+
+  if(NULL == slot) {
+    if(free_idx == queue->count) {
+      return MQTT_OUT_OF_MEM;
+    }
+    idx = free_idx;
+    slot = &queue->slots[idx];
+    slot->state = SLOT_USED;
+    slot->hash = hash;
+    slot->topic_len = (uint16_t) params->topic.length;
+    memcpy( queue->value + idx * queue->slot_size, params->topic.value, params->topic.length );
+    ++queue->length;
+  }
+
+  /* Topic Name is already stored, the rest is replaced */
+  buf = queue->value + idx * queue->slot_size + slot->topic_len;
+  if(properties_len) {
+    memcpy( buf, params->properties.value, properties_len );
+  }
+  if(params->message.length) {
+    memcpy( buf + properties_len, params->message.value, params->message.length );
+  }
+  slot->properties_len = (uint8_t) properties_len;
+  slot->expiry_offset = expiry_offset;
+  if(expiry_offset) {
+    buf += expiry_offset - 1;
+    slot->expiry = now + (((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | buf[3]);
+  }
+  slot->message_len = (uint16_t) params->message.length;
+  slot->flags = params->flags;
+  slot->lane = lane;
+  slot->seq = ++queue->seq;
+
+  return MQTT_SUCCESS;
+}
+
+uint8_t __ATTR mqtt_queue_peek(mqtt_queue_t *queue, mqtt_publish_params_t *params, uint32_t now) {
+  mqtt_queue_slot_t *slot;
+  size_t i, front;
+  uint32_t remaining;
+  uint8_t *buf;
+
+  /* Finding the oldest message of the highest lane and dropping expired ones, sequence numbers could wrap around */
+  front = queue->count;
+  for(i=0; i<queue->count && queue->length; ++i) {
+    slot = &queue->slots[i];
+    if(slot->state != SLOT_USED) {
+      continue;
+    }
+    if(slot->expiry_offset && (int32_t) (now - slot->expiry) >= 0) {
+      mqtt_queue_release( queue, i );
+      ++queue->expired;
+    }
+    else if(front == queue->count || slot->lane < queue->slots[front].lane
+      || (slot->lane == queue->slots[front].lane && (int32_t) (slot->seq - queue->slots[front].seq) < 0)) {
+      front = i;
+    }
+  }
+  if(!queue->length) {
+    return 0;
+  }
+  queue->front = front;
+
+  slot = &queue->slots[front];
+  buf = queue->value + front * queue->slot_size;
+
+  /* Message Expiry Interval is set to the remaining time */
+  if(slot->expiry_offset) {
+    remaining = slot->expiry - now;
+    buf[slot->topic_len + slot->expiry_offset - 1] = (uint8_t) (remaining >> 24);
+    buf[slot->topic_len + slot->expiry_offset] = (uint8_t) (remaining >> 16);
+    buf[slot->topic_len + slot->expiry_offset + 1] = (uint8_t) (remaining >> 8);
+    buf[slot->topic_len + slot->expiry_offset + 2] = (uint8_t) (remaining);
+  }
+
+  params->flags = slot->flags;
+  params->topic.length = slot->topic_len;
+  params->topic.value = buf;
+  params->properties.length = slot->properties_len;
+  params->properties.value = slot->properties_len ? buf + slot->topic_len : NULL;
+  params->message.length = slot->message_len;
+  params->message.value = buf + slot->topic_len + slot->properties_len;
+
+  return 1;
+}
+
+void __ATTR mqtt_queue_pop(mqtt_queue_t *queue) {
+  if(!queue->length || queue->slots[queue->front].state != SLOT_USED) {
+    return;
+  }
+
+  mqtt_queue_release( queue, queue->front );
+}
@@ -0,0 +1,124 @@
+#include <string.h>
+
+#include "../api/mqtt_ratelimit.h"
+
+/**
+ * @brief Refills the bucket.
+ *
+ * @param tokens pointer to the available tokens multiplied by 1000
+ * @param rate tokens per second
+ * @param burst maximum number of tokens
+ * @param elapsed number of milliseconds since the last refill
+ */
+static void __ATTR mqtt_ratelimit_refill(uint64_t *tokens, uint32_t rate, uint32_t burst, uint32_t elapsed) {
+  *tokens += (uint64_t) elapsed * rate;
+  if(*tokens > (uint64_t) burst * 1000) {
+    *tokens = (uint64_t) burst * 1000;
+  }
+}
+
+/**
+ * @brief Calculates the time needed to obtain the missing tokens.
+ *
+ * @param tokens available tokens multiplied by 1000
+ * @param needed needed tokens multiplied by 1000
+ * @param rate tokens per second
+ *
+ * @returns number of milliseconds, 0 if enough tokens are available
+ */
+static uint32_t __ATTR mqtt_ratelimit_wait(uint64_t tokens, uint64_t needed, uint32_t rate) {
+  if(!rate || tokens >= needed) {
+    return 0;
+  }
+
+  return (uint32_t) ((needed - tokens + rate - 1) / rate);
+}
+
+/**
+ * @brief Refills both buckets and checks if the message could be sent.
+ *
+ * @param limit pointer to the rate limiter
+ * @param bytes number of bytes of the message
+ * @param now current time in milliseconds
+ * @param wait pointer to the number of milliseconds until enough tokens are available, could be NULL
+ *
+ * @returns MQTT_SUCCESS, MQTT_INVALID_ARGS or MQTT_THROTTLED
+ */
+static uint16_t __ATTR mqtt_ratelimit_check(mqtt_ratelimit_t *limit, size_t bytes, uint32_t now, uint32_t *wait) {
+  uint32_t msg_wait, byte_wait;
+
+  if(limit->byte_rate && bytes > limit->byte_burst) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  if(limit->msg_rate) {
+    mqtt_ratelimit_refill( &limit->msg_tokens, limit->msg_rate, limit->msg_burst, now - limit->last );
+  }
+  if(limit->byte_rate) {
+    mqtt_ratelimit_refill( &limit->byte_tokens, limit->byte_rate, limit->byte_burst, now - limit->last );
+  }
+  limit->last = now;
+
+  msg_wait = mqtt_ratelimit_wait( limit->msg_tokens, 1000, limit->msg_rate );
+  byte_wait = mqtt_ratelimit_wait( limit->byte_tokens, (uint64_t) bytes * 1000, limit->byte_rate );
+  if(NULL != wait) {
+    *wait = msg_wait > byte_wait ? msg_wait : byte_wait;
+  }
+
+  return (msg_wait || byte_wait) ? MQTT_THROTTLED : MQTT_SUCCESS;
+}
+
+/**
+ * @brief Consumes the tokens of the message.
+ *
+ * @param limit pointer to the rate limiter
+ * @param bytes number of bytes of the message
+ */
+static void __ATTR mqtt_ratelimit_consume(mqtt_ratelimit_t *limit, size_t bytes) {
+  if(limit->msg_rate) {
+    limit->msg_tokens -= 1000;
+  }
+  if(limit->byte_rate) {
+    limit->byte_tokens -= (uint64_t) bytes * 1000;
+  }
+}
+
+void __ATTR mqtt_ratelimit_init(mqtt_ratelimit_t *limit, uint32_t msg_rate, uint32_t msg_burst, uint32_t byte_rate, uint32_t byte_burst, uint32_t now) {
+  memset( limit, 0x00, sizeof(mqtt_ratelimit_t) );
+  limit->msg_rate = msg_rate;
+  limit->msg_burst = msg_burst ? msg_burst : 1;
+  limit->byte_rate = byte_rate;
+  limit->byte_burst = byte_burst;
+  limit->msg_tokens = (uint64_t) limit->msg_burst * 1000;
+  limit->byte_tokens = (uint64_t) limit->byte_burst * 1000;
+  limit->last = now;
+}
+
+uint16_t __ATTR mqtt_ratelimit_take(mqtt_ratelimit_t *limit, size_t bytes, uint32_t now, uint32_t *wait) {
+  uint16_t rc;
+
+  if(MQTT_SUCCESS == (rc = mqtt_ratelimit_check( limit, bytes, now, wait ))) {
+    mqtt_ratelimit_consume( limit, bytes );
+  }
+
+  return rc;
+}
+
+uint16_t __ATTR mqtt_ratelimit_publish(mqtt_ratelimit_t *limit, const mqtt_cli_t *cli, const mqtt_publish_params_t *params, uint32_t now, uint32_t *wait) {
+  size_t bytes;
+  uint16_t rc;
+
+  if(NULL == limit || NULL == cli || NULL == params) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  bytes = params->topic.length + params->message.length + (params->properties.value ? params->properties.length : 0);
+  if(MQTT_SUCCESS != (rc = mqtt_ratelimit_check( limit, bytes, now, wait ))) {
+    return rc;
+  }
+  if(MQTT_SUCCESS == (rc = cli->publish( cli, params ))) {
+    mqtt_ratelimit_consume( limit, bytes );
+  }
+
+  return rc;
+}
@@ -0,0 +1,199 @@
+#include <string.h>
+
+#include "../api/mqtt_rpc.h"
+
+/** No slot */
+#define SLOT_NONE             ((uint32_t) 0xFFFFFFFF)
+/** Response Topic property */
+#define PROP_RESPONSE_TOPIC   0x08
+/** Correlation Data property */
+#define PROP_CORRELATION_DATA 0x09
+
+/**
+ * @brief Removes the request from the pending list and puts the slot on the free list.
+ *
+ * @param rpc pointer to the correlation table
+ * @param idx index of the slot
+ */
+static void __ATTR mqtt_rpc_release(mqtt_rpc_t *rpc, uint32_t idx) {
+  mqtt_rpc_slot_t *slot = &rpc->slots[idx];
+
+  if(slot->prev != SLOT_NONE) {
+    rpc->slots[slot->prev].next = slot->next;
+  }
+  else {
+    rpc->head = slot->next;
+  }
+  if(slot->next != SLOT_NONE) {
+    rpc->slots[slot->next].prev = slot->prev;
+  }
+  else {
+    rpc->tail = slot->prev;
+  }
+
+  slot->cb = NULL;
+  slot->arg = NULL;
+  ++slot->generation;
+  slot->prev = SLOT_NONE;
+  slot->next = rpc->free;
+  rpc->free = idx;
+  --rpc->pending;
+}
+
+void __ATTR mqtt_rpc_init(mqtt_rpc_t *rpc, mqtt_rpc_slot_t *slots, uint32_t count, const lv_t *response_topic, uint32_t timeout) {
+  uint32_t i;
+
+  memset( rpc, 0x00, sizeof(mqtt_rpc_t) );
+  memset( slots, 0x00, count * sizeof(mqtt_rpc_slot_t) );
+  for(i=0; i<count; ++i) {
+    slots[i].prev = SLOT_NONE;
+    slots[i].next = (i + 1 < count) ? i + 1 : SLOT_NONE;
+  }
+  rpc->slots = slots;
+  rpc->count = count;
+  rpc->free = count ? 0 : SLOT_NONE;
+  rpc->head = SLOT_NONE;
+  rpc->tail = SLOT_NONE;
+  rpc->timeout = timeout;
+  rpc->response_topic = *response_topic;
+}
+
+uint16_t __ATTR mqtt_rpc_prepare(mqtt_rpc_t *rpc, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity, cb_mqtt_rpc_t cb, void *arg, uint32_t now, uint32_t *slot) {
+  mqtt_rpc_slot_t *s;
+  size_t length, properties_len;
+  uint32_t idx;
+
+  if(NULL == rpc || NULL == params || NULL == buf || NULL == cb) {
+    return MQTT_INVALID_ARGS;
+  }
+  properties_len = params->properties.value ? params->properties.length : 0;
+  length = 3 + rpc->response_topic.length + 3 + MQTT_RPC_TOKEN_LEN + properties_len;
+  if(length > capacity || length > MAX_PROPERTIES_LEN) {
+    return MQTT_OUT_OF_MEM;
+  }
+  if(rpc->free == SLOT_NONE) {
+    return MQTT_NO_PKT_ID;
+  }
+
+  /* Taking the first free slot and appending it to the pending list */
+  idx = rpc->free;
+  s = &rpc->slots[idx];
+  rpc->free = s->next;
+  s->cb = cb;
+  s->arg = arg;
+  s->deadline = now + rpc->timeout;
+  s->prev = rpc->tail;
+  s->next = SLOT_NONE;
+  if(rpc->tail != SLOT_NONE) {
+    rpc->slots[rpc->tail].next = idx;
+  }
+  else {
+    rpc->head = idx;
+  }
+  rpc->tail = idx;
+  ++rpc->pending;
+
+  /* Response Topic, Correlation Data (slot and generation) and the user properties */
+  if(properties_len) {
+    memmove( buf + length - properties_len, params->properties.value, properties_len );
+  }
+  buf[0] = PROP_RESPONSE_TOPIC;
+  buf[1] = (uint8_t) (rpc->response_topic.length >> 8);
+  buf[2] = (uint8_t) (rpc->response_topic.length);
+  memcpy( buf + 3, rpc->response_topic.value, rpc->response_topic.length );
+  buf += 3 + rpc->response_topic.length;
+  buf[0] = PROP_CORRELATION_DATA;
+  buf[1] = 0;
+  buf[2] = MQTT_RPC_TOKEN_LEN;
+  buf[3] = (uint8_t) (idx >> 24);
+  buf[4] = (uint8_t) (idx >> 16);
+  buf[5] = (uint8_t) (idx >> 8);
+  buf[6] = (uint8_t) (idx);
+  buf[7] = (uint8_t) (s->generation >> 24);
+  buf[8] = (uint8_t) (s->generation >> 16);
+  buf[9] = (uint8_t) (s->generation >> 8);
+  buf[10] = (uint8_t) (s->generation);
+  params->properties.value = buf - 3 - rpc->response_topic.length;
+  params->properties.length = length;
+
+  if(NULL != slot) {
+    *slot = idx;
+  }
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_rpc_cancel(mqtt_rpc_t *rpc, uint32_t slot) {
+  if(slot < rpc->count && NULL != rpc->slots[slot].cb) {
+    mqtt_rpc_release( rpc, slot );
+  }
+}
+
+uint16_t __ATTR mqtt_rpc_request(mqtt_rpc_t *rpc, const mqtt_cli_t *cli, mqtt_publish_params_t *params, uint8_t *buf, size_t capacity, cb_mqtt_rpc_t cb, void *arg, uint32_t now) {
+  uint32_t slot;
+  uint16_t rc;
+
+  if(NULL == cli) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(MQTT_SUCCESS != (rc = mqtt_rpc_prepare( rpc, params, buf, capacity, cb, arg, now, &slot ))) {
+    return rc;
+  }
+  if(MQTT_SUCCESS != (rc = cli->publish( cli, params ))) {
+    mqtt_rpc_cancel( rpc, slot );
+  }
+
+  return rc;
+}
+
+uint8_t __ATTR mqtt_rpc_response(mqtt_rpc_t *rpc, const mqtt_cli_ctx_cb_t *self, const mqtt_publish_t *pkt) {
+  size_t offset = 0, used = 0, length;
+  const uint8_t *buf;
+  uint32_t idx, generation;
+  cb_mqtt_rpc_t cb;
+  void *arg;
+
+  if(!pkt->properties.length || NULL == pkt->properties.value) {
+    return 0;
+  }
+  length = pkt->properties.length;
+  self->find_property( PROP_CORRELATION_DATA, pkt->properties.value, &offset, &used, &length );
+  if(length != MQTT_RPC_TOKEN_LEN) {
+    return 0;
+  }
+
+  buf = pkt->properties.value + offset + 1 + used;
+  idx = ((uint32_t) buf[0] << 24) | ((uint32_t) buf[1] << 16) | ((uint32_t) buf[2] << 8) | buf[3];
+  generation = ((uint32_t) buf[4] << 24) | ((uint32_t) buf[5] << 16) | ((uint32_t) buf[6] << 8) | buf[7];
+  if(idx >= rpc->count || NULL == rpc->slots[idx].cb || rpc->slots[idx].generation != generation) {
+    return 0;
+  }
+
+  /* The slot is released first, so the callback could send a new request */
+  cb = rpc->slots[idx].cb;
+  arg = rpc->slots[idx].arg;
+  mqtt_rpc_release( rpc, idx );
+  cb( arg, pkt );
+
+  return 1;
+}
+
+size_t __ATTR mqtt_rpc_expire(mqtt_rpc_t *rpc, uint32_t now) {
+  size_t expired = 0;
+  uint32_t idx;
+  cb_mqtt_rpc_t cb;
+  void *arg;
+
+  /* All requests use the same timeout, so the pending list is ordered by the deadline */
+  while(rpc->head != SLOT_NONE && (int32_t) (now - rpc->slots[rpc->head].deadline) >= 0) {
+    idx = rpc->head;
+    cb = rpc->slots[idx].cb;
+    arg = rpc->slots[idx].arg;
+    mqtt_rpc_release( rpc, idx );
+    cb( arg, NULL );
+    ++expired;
+  }
+  rpc->expired += expired;
+
+  return expired;
+}
@@ -0,0 +1,188 @@
+#include <string.h>
+
+#include "../api/mqtt_subscription.h"
+#include "../api/mqtt_topic.h"
+
+/**
+ * @brief Finds the stored Topic Filter.
+ *
+ * @param set pointer to the subscription set
+ * @param value pointer to the Topic Filter value
+ * @param length length of the Topic Filter
+ *
+ * @returns offset of the filter or length of the set if the filter was not found
+ */
+static size_t __ATTR mqtt_subscription_find(const mqtt_subscription_set_t *set, const uint8_t *value, size_t length) {
+  size_t offset = 0, len;
+
+  while(offset < set->length) {
+    len = ((size_t) set->value[offset] << 8) | set->value[offset + 1];
+    if(len == length && !memcmp( set->value + offset + 2, value, length )) {
+      break;
+    }
+    offset += 2 + len + 1;
+  }
+
+  return offset;
+}
+
+/**
+ * @brief Encodes the Variable Byte Integer.
+ *
+ * @param buf pointer to the buffer
+ * @param value value to encode
+ *
+ * @returns number of bytes used
+ */
+static size_t __ATTR mqtt_subscription_encode_size(uint8_t *buf, size_t value) {
+  size_t used = 0;
+
+  do {
+    buf[used] = (uint8_t) (value & 0x7F);
+    value >>= 7;
+    if(value) {
+      buf[used] |= 0x80;
+    }
+    ++used;
+  } while(value);
+
+  return used;
+}
+
+void __ATTR mqtt_subscription_init(mqtt_subscription_set_t *set, uint8_t version, uint8_t *buf, size_t capacity) {
+  memset( set, 0x00, sizeof(mqtt_subscription_set_t) );
+  set->value = buf;
+  set->capacity = capacity;
+  set->version = version;
+  set->max_packet_size = capacity;
+}
+
+uint16_t __ATTR mqtt_subscription_add(mqtt_subscription_set_t *set, const mqtt_subscribe_filter_t *filter) {
+  lv_t topic;
+  size_t offset;
+  uint8_t *buf;
+
+  if(NULL == set || NULL == filter) {
+    return MQTT_INVALID_ARGS;
+  }
+  topic.length = filter->length;
+  topic.value = filter->value;
+  if(MQTT_SUCCESS != mqtt_topic_validate_filter( &topic )) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  /* Updating Subscription Options of the existing filter */
+  if((offset = mqtt_subscription_find( set, filter->value, filter->length )) < set->length) {
+    set->value[offset + 2 + filter->length] = filter->options;
+    return MQTT_SUCCESS;
+  }
+
+  if(set->length + 2 + filter->length + 1 > set->capacity) {
+    return MQTT_OUT_OF_MEM;
+  }
+
+  buf = set->value + set->length;
+  buf[0] = (uint8_t) (filter->length >> 8);
+  buf[1] = (uint8_t) (filter->length);
+  memcpy( buf + 2, filter->value, filter->length );
+  buf[2 + filter->length] = filter->options;
+
+  /* Filter added while nothing is pending is subscribed by the user */
+  if(set->restore == set->length) {
+    set->restore += 2 + filter->length + 1;
+  }
+  set->length += 2 + filter->length + 1;
+  ++set->count;
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_subscription_remove(mqtt_subscription_set_t *set, const lv_t *filter) {
+  size_t offset, size;
+
+  if(NULL == set || NULL == filter || (offset = mqtt_subscription_find( set, filter->value, filter->length )) >= set->length) {
+    return MQTT_INVALID_ARGS;
+  }
+
+  size = 2 + filter->length + 1;
+  memmove( set->value + offset, set->value + offset + size, set->length - offset - size );
+  set->length -= size;
+  if(set->restore > offset) {
+    set->restore -= size;
+  }
+  --set->count;
+
+  return MQTT_SUCCESS;
+}
+
+void __ATTR mqtt_subscription_connack(mqtt_subscription_set_t *set, const mqtt_limits_t *limits, const mqtt_connack_t *pkt, size_t max_packet_size) {
+  set->max_packet_size = max_packet_size;
+  if(NULL != limits && limits->max_packet_size && limits->max_packet_size < set->max_packet_size) {
+    set->max_packet_size = limits->max_packet_size;
+  }
+
+  /* Subscriptions are kept by the broker if Session Present flag was set */
+  set->restore = (pkt->connect_ack_flags & 0x01) ? set->length : 0;
+}
+
+uint16_t __ATTR mqtt_subscription_restore(mqtt_subscription_set_t *set, const mqtt_cli_t *cli, clv_t *output) {
+  mqtt_subscribe_params_t params;
+  size_t offset, end, next, len, remaining, used, header;
+  uint8_t id[2], count;
+  uint8_t *buf;
+  uint16_t rc;
+
+  output->length = 0;
+  if(set->restore >= set->length) {
+    return MQTT_SUCCESS;
+  }
+
+  /* The first filter is prepared by the client to allocate Packet Identifier */
+  offset = set->restore;
+  len = ((size_t) set->value[offset] << 8) | set->value[offset + 1];
+  memset( &params, 0x00, sizeof(params) );
+  params.filter.length = len;
+  params.filter.value = set->value + offset + 2;
+  params.filter.options = set->value[offset + 2 + len];
+  if(MQTT_SUCCESS != (rc = cli->subscribe_ex( cli, &params, output ))) {
+    return rc;
+  }
+
+  used = 1;
+  while(output->value[used++] & 0x80);
+  id[0] = output->value[used];
+  id[1] = output->value[used + 1];
+
+  /* Packet Identifier and empty Properties */
+  header = set->version >= 5 ? 3 : 2;
+  end = offset + 2 + len + 1;
+  count = 1;
+  while(end < set->length && count < MAX_TOPIC_FILTERS) {
+    next = end + 2 + (((size_t) set->value[end] << 8) | set->value[end + 1]) + 1;
+    remaining = header + next - offset;
+    used = remaining < 128 ? 1 : remaining < 16384 ? 2 : remaining < 2097152 ? 3 : 4;
+    if(1 + used + remaining > set->max_packet_size || 1 + used + remaining > output->capacity) {
+      break;
+    }
+    end = next;
+    ++count;
+  }
+
+  /* Rebuilding the packet with all filters which fit */
+  if(count > 1) {
+    buf = output->value;
+    remaining = header + end - offset;
+    buf[0] = (uint8_t) (PTYPE_SUBSCRIBE << 4) | 0x02;
+    used = 1 + mqtt_subscription_encode_size( buf + 1, remaining );
+    buf[used] = id[0];
+    buf[used + 1] = id[1];
+    if(set->version >= 5) {
+      buf[used + 2] = 0x00;
+    }
+    memcpy( buf + used + header, set->value + offset, end - offset );
+    output->length = used + remaining;
+  }
+  set->restore = end;
+
+  return set->restore < set->length ? MQTT_PENDING_DATA : MQTT_SUCCESS;
+}
@@ -0,0 +1,349 @@
+#include <string.h>
+
+#include "../api/mqtt_topic.h"
+
+#if defined(__AVX2__) || defined(__SSE2__)
+  #include <immintrin.h>
+#elif defined(__ARM_NEON)
+  #include <arm_neon.h>
+#endif
+
+/** Byte with the lowest bit set in all lanes */
+#define SWAR_ONES   ( ((uint64_t) 0x01010101UL << 32) | 0x01010101UL )
+/** Byte with the highest bit set in all lanes */
+#define SWAR_HIGHS  ( SWAR_ONES * 0x80 )
+/** Non zero if any lane of the value is equal to zero */
+#define SWAR_HAS_ZERO(v)  ( ((v) - SWAR_ONES) & ~(v) & SWAR_HIGHS )
+
+/** Non zero if the character can be accepted without any further checks */
+#define IS_PLAIN(c) ( (c) != 0x00 && (c) < 0x80 && (c) != '+' && (c) != '#' )
+
+/**
+ * @brief Calculates the number of leading plain characters, i.e. ASCII without U+0000 and wildcards.
+ *
+ * @param buf pointer to the data
+ * @param len length of the data
+ *
+ * @returns number of leading plain characters
+ */
+static size_t __ATTR mqtt_topic_plain_len(const uint8_t *buf, size_t len) {
+  size_t i = 0;
+#if defined(__AVX2__)
+  __m256i v, special;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i plus = _mm256_set1_epi8( '+' );
+  const __m256i hash = _mm256_set1_epi8( '#' );
+  uint32_t mask;
+
+  for(; i + 32 <= len; i += 32) {
+    v = _mm256_loadu_si256( (const __m256i*) (buf + i) );
+    special = _mm256_or_si256( _mm256_cmpeq_epi8( v, zero ),
+      _mm256_or_si256( _mm256_cmpeq_epi8( v, plus ), _mm256_cmpeq_epi8( v, hash ) ) );
+    /* the highest bit of v marks non ASCII characters */
+    mask = (uint32_t) _mm256_movemask_epi8( _mm256_or_si256( special, v ) );
+    if(mask) {
+      return i + __builtin_ctz( mask );
+    }
+  }
+#elif defined(__SSE2__)
+  __m128i v, special;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i plus = _mm_set1_epi8( '+' );
+  const __m128i hash = _mm_set1_epi8( '#' );
+  uint32_t mask;
+
+  for(; i + 16 <= len; i += 16) {
+    v = _mm_loadu_si128( (const __m128i*) (buf + i) );
+    special = _mm_or_si128( _mm_cmpeq_epi8( v, zero ),
+      _mm_or_si128( _mm_cmpeq_epi8( v, plus ), _mm_cmpeq_epi8( v, hash ) ) );
+    /* the highest bit of v marks non ASCII characters */
+    mask = (uint32_t) _mm_movemask_epi8( _mm_or_si128( special, v ) );
+    if(mask) {
+      return i + __builtin_ctz( mask );
+    }
+  }
+#elif defined(__ARM_NEON) && defined(__aarch64__)
+  uint8x16_t v, special;
+  const uint8x16_t plus = vdupq_n_u8( '+' );
+  const uint8x16_t hash = vdupq_n_u8( '#' );
+  const uint8x16_t ascii = vdupq_n_u8( 0x80 );
+
+  for(; i + 16 <= len; i += 16) {
+    v = vld1q_u8( buf + i );
+    special = vorrq_u8( vceqzq_u8( v ), vorrq_u8( vceqq_u8( v, plus ), vceqq_u8( v, hash ) ) );
+    special = vorrq_u8( special, vcgeq_u8( v, ascii ) );
+    if(vmaxvq_u8( special )) {
+      break;
+    }
+  }
+#else
+  uint64_t v;
+
+  for(; i + 8 <= len; i += 8) {
+    memcpy( &v, buf + i, sizeof(v) );
+    if( (v & SWAR_HIGHS) || SWAR_HAS_ZERO( v ) || SWAR_HAS_ZERO( v ^ (SWAR_ONES * '+') ) || SWAR_HAS_ZERO( v ^ (SWAR_ONES * '#') ) ) {
+      break;
+    }
+  }
+#endif
+
+  /* Locate the special character within the chunk or check the tail */
+  while(i < len && IS_PLAIN( buf[i] )) {
+    ++i;
+  }
+
+  return i;
+}
+
+/**
+ * @brief Calculates the length of single UTF-8 encoded character (RFC 3629).
+ *
+ * @param buf pointer to the first byte of the character
+ * @param len number of available bytes
+ *
+ * @returns number of bytes used by the character or 0 if the character is not well-formed
+ *
+ * @note Overlong encodings, surrogates (U+D800..U+DFFF) and code points above U+10FFFF are rejected.
+ */
+static size_t __ATTR mqtt_topic_utf8_len(const uint8_t *buf, size_t len) {
+  uint8_t c = buf[0], lo = 0x80, hi = 0xBF;
+  size_t n, i;
+
+  if(c >= 0xC2 && c <= 0xDF) {
+    n = 2;
+  }
+  else if(c >= 0xE0 && c <= 0xEF) {
+    n = 3;
+    if(c == 0xE0) {
+      lo = 0xA0;
+    }
+    else if(c == 0xED) {
+      hi = 0x9F;
+    }
+  }
+  else if(c >= 0xF0 && c <= 0xF4) {
+    n = 4;
+    if(c == 0xF0) {
+      lo = 0x90;
+    }
+    else if(c == 0xF4) {
+      hi = 0x8F;
+    }
+  }
+  else {
+    return 0;
+  }
+
+  if(n > len || buf[1] < lo || buf[1] > hi) {
+    return 0;
+  }
+  for(i=2; i<n; ++i) {
+    if( (buf[i] & 0xC0) != 0x80 ) {
+      return 0;
+    }
+  }
+
+  return n;
+}
+
+/**
+ * @brief Validates the Topic Name or Topic Filter.
+ *
+ * @param topic pointer to the topic
+ * @param is_filter 1 if wildcards are allowed, otherwise 0
+ *
+ * @returns MQTT_SUCCESS if the topic is valid, otherwise MQTT_INVALID_ARGS
+ */
+static uint16_t __ATTR mqtt_topic_validate(const lv_t *topic, uint8_t is_filter) {
+  const uint8_t *buf;
+  size_t len, i = 0, n;
+  uint8_t c;
+
+  if(NULL == topic || NULL == topic->value || topic->length < MIN_TOPIC_LEN || topic->length > MAX_TOPIC_LEN) {
+    return MQTT_INVALID_ARGS;
+  }
+  buf = topic->value;
+  len = topic->length;
+
+  while(i < len) {
+    i += mqtt_topic_plain_len( buf + i, len - i );
+    if(i == len) {
+      break;
+    }
+
+    c = buf[i];
+    if(c == 0x00) {
+      return MQTT_INVALID_ARGS;
+    }
+    else if(c == '+' || c == '#') {
+      /* Wildcard shall occupy an entire level, multi-level wildcard shall be the last character */
+      if( !is_filter || (i > 0 && buf[i-1] != '/') ) {
+        return MQTT_INVALID_ARGS;
+      }
+      if( (c == '#' && i + 1 != len) || (c == '+' && i + 1 < len && buf[i+1] != '/') ) {
+        return MQTT_INVALID_ARGS;
+      }
+      ++i;
+    }
+    else {
+      if( 0 == (n = mqtt_topic_utf8_len( buf + i, len - i )) ) {
+        return MQTT_INVALID_ARGS;
+      }
+      i += n;
+    }
+  }
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_topic_validate_name(const lv_t *topic) {
+  return mqtt_topic_validate( topic, 0 );
+}
+
+uint16_t __ATTR mqtt_topic_validate_filter(const lv_t *filter) {
+  return mqtt_topic_validate( filter, 1 );
+}
+
+/**
+ * @brief Splits the topic into levels.
+ *
+ * @param buf pointer to the topic
+ * @param len length of the topic
+ * @param offset pointer to the array receiving offsets of the levels, offset[levels] points one byte past the end of the topic
+ *
+ * @returns number of levels or MAX_TOPIC_LEVELS + 1 if the topic has more levels than MAX_TOPIC_LEVELS
+ *
+ * @note If the topic has more levels than MAX_TOPIC_LEVELS then only offsets of the first MAX_TOPIC_LEVELS + 1 levels are stored.
+ */
+static size_t __ATTR mqtt_topic_split(const uint8_t *buf, size_t len, uint16_t *offset) {
+  const uint8_t *sep;
+  size_t levels = 0, pos = 0;
+
+  offset[0] = 0;
+  while( NULL != (sep = (const uint8_t*) memchr( buf + pos, '/', len - pos )) ) {
+    pos = (size_t) (sep - buf) + 1;
+    offset[++levels] = (uint16_t) pos;
+    if(levels == MAX_TOPIC_LEVELS) {
+      return MAX_TOPIC_LEVELS + 1;
+    }
+  }
+  offset[++levels] = (uint16_t) (len + 1);
+
+  return levels;
+}
+
+/**
+ * @brief Checks if the topic split into levels matches the compiled filter.
+ *
+ * @param filter pointer to the compiled filter
+ * @param buf pointer to the topic
+ * @param offset pointer to offsets of the topic levels
+ * @param levels number of the topic levels
+ *
+ * @returns 1 if the topic matches the filter, otherwise 0
+ */
+static uint8_t __ATTR mqtt_topic_match_levels(const mqtt_topic_filter_t *filter, const uint8_t *buf, const uint16_t *offset, size_t levels) {
+  size_t i, exact, len;
+
+  /* Multi-level wildcard matches also the parent level */
+  if(filter->multi) {
+    exact = (size_t) filter->levels - 1;
+    if(levels < exact) {
+      return 0;
+    }
+  }
+  else {
+    exact = filter->levels;
+    if(levels != exact) {
+      return 0;
+    }
+  }
+
+  /* Wildcards shall not match topics starting with '$' */
+  if(buf[0] == '$' && ( (filter->single & 1) || 0 == exact )) {
+    return 0;
+  }
+
+  for(i=0; i<exact; ++i) {
+    if(filter->single & ((uint32_t) 1 << i)) {
+      continue;
+    }
+    len = (size_t) (filter->offset[i+1] - filter->offset[i]);
+    if(len != (size_t) (offset[i+1] - offset[i]) || 0 != memcmp( filter->value + filter->offset[i], buf + offset[i], len - 1 )) {
+      return 0;
+    }
+  }
+
+  return 1;
+}
+
+uint16_t __ATTR mqtt_topic_compile(mqtt_topic_filter_t *compiled, const lv_t *filter) {
+  static const uint8_t SHARE[] = { '$', 's', 'h', 'a', 'r', 'e', '/' };
+  const uint8_t *buf, *sep;
+  size_t len, levels, i, level_len;
+
+  if(NULL == compiled || MQTT_SUCCESS != mqtt_topic_validate_filter( filter )) {
+    return MQTT_INVALID_ARGS;
+  }
+  buf = filter->value;
+  len = filter->length;
+
+  /* Shared Subscription: $share/{ShareName}/{filter} */
+  if(len > sizeof(SHARE) && 0 == memcmp( buf, SHARE, sizeof(SHARE) )) {
+    sep = (const uint8_t*) memchr( buf + sizeof(SHARE), '/', len - sizeof(SHARE) );
+    if(NULL == sep || sep == buf + sizeof(SHARE) || (size_t) (sep - buf) + 1 == len) {
+      return MQTT_INVALID_ARGS;
+    }
+    len -= (size_t) (sep - buf) + 1;
+    buf = sep + 1;
+  }
+
+  memset( compiled, 0x00, sizeof(mqtt_topic_filter_t) );
+  if( MAX_TOPIC_LEVELS < (levels = mqtt_topic_split( buf, len, compiled->offset )) ) {
+    return MQTT_INVALID_ARGS;
+  }
+  compiled->value = buf;
+  compiled->levels = (uint8_t) levels;
+  for(i=0; i<levels; ++i) {
+    level_len = (size_t) (compiled->offset[i+1] - compiled->offset[i]) - 1;
+    if(level_len == 1 && buf[compiled->offset[i]] == '+') {
+      compiled->single |= (uint32_t) 1 << i;
+    }
+  }
+  compiled->multi = (buf[len - 1] == '#') ? 1 : 0;
+
+  return MQTT_SUCCESS;
+}
+
+uint8_t __ATTR mqtt_topic_match(const mqtt_topic_filter_t *filter, const lv_t *topic) {
+  uint16_t offset[MAX_TOPIC_LEVELS + 2];
+  size_t levels;
+
+  if(NULL == filter || NULL == topic || NULL == topic->value || 0 == topic->length) {
+    return 0;
+  }
+  levels = mqtt_topic_split( topic->value, topic->length, offset );
+
+  return mqtt_topic_match_levels( filter, topic->value, offset, levels );
+}
+
+size_t __ATTR mqtt_topic_match_all(const mqtt_topic_filter_t *filters, size_t count, const lv_t *topic, size_t *matches, size_t capacity) {
+  uint16_t offset[MAX_TOPIC_LEVELS + 2];
+  size_t levels, i, found = 0;
+
+  if(NULL == filters || NULL == topic || NULL == topic->value || 0 == topic->length) {
+    return 0;
+  }
+  levels = mqtt_topic_split( topic->value, topic->length, offset );
+
+  for(i=0; i<count; ++i) {
+    if(mqtt_topic_match_levels( &filters[i], topic->value, offset, levels )) {
+      if(matches && found < capacity) {
+        matches[found] = i;
+      }
+      ++found;
+    }
+  }
+
+  return found;
+}
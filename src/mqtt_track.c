@@ -0,0 +1,167 @@
+#include <string.h>
+
+#include "../api/mqtt_track.h"
+
+/** PUBLISH packet type */
+#define TYPE_PUBLISH  0x30
+
+/**
+ * @brief Finds the free slot.
+ *
+ * @param track pointer to the completion table
+ *
+ * @returns the free slot or NULL if all slots are used
+ */
+static mqtt_track_slot_t* __ATTR mqtt_track_free(mqtt_track_t *track) {
+  size_t i;
+
+  if(track->pending >= track->count) {
+    return NULL;
+  }
+  for(i=0; i<track->count; ++i) {
+    if(NULL == track->slots[i].cb) {
+      return &track->slots[i];
+    }
+  }
+
+  return NULL;
+}
+
+void __ATTR mqtt_track_init(mqtt_track_t *track, mqtt_track_slot_t *slots, size_t count) {
+  memset( track, 0x00, sizeof(mqtt_track_t) );
+  memset( slots, 0x00, count * sizeof(mqtt_track_slot_t) );
+  track->slots = slots;
+  track->count = count;
+}
+
+uint16_t __ATTR mqtt_track_id(const lv_t *packet, uint16_t *id) {
+  const uint8_t *buf = packet->value;
+  size_t offset = 1, remaining = 0, topic_len;
+  uint8_t byte;
+
+  if(packet->length < 2 || (buf[0] & 0xF0) != TYPE_PUBLISH) {
+    return MQTT_MALFORMED_PACKET;
+  }
+  do {
+    if(offset >= packet->length || offset > 4) {
+      return MQTT_MALFORMED_PACKET;
+    }
+    byte = buf[offset];
+    remaining |= (size_t) (byte & 0x7F) << (7 * (offset - 1));
+    ++offset;
+  } while(byte & 0x80);
+  if(offset + remaining > packet->length || remaining < 2) {
+    return MQTT_MALFORMED_PACKET;
+  }
+
+  if(!(buf[0] & 0x06)) {
+    *id = 0;
+    return MQTT_SUCCESS;
+  }
+  /* Packet Identifier follows Topic Name */
+  topic_len = (buf[offset] << 8) | buf[offset + 1];
+  if(2 + topic_len + 2 > remaining) {
+    return MQTT_MALFORMED_PACKET;
+  }
+  offset += 2 + topic_len;
+  *id = (uint16_t) ((buf[offset] << 8) | buf[offset + 1]);
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_track_add(mqtt_track_t *track, const lv_t *packet, cb_mqtt_track_t cb, void *arg, uint16_t *id) {
+  mqtt_track_slot_t *slot;
+  uint16_t rc, pkt_id;
+
+  if(NULL == track || NULL == packet || NULL == cb) {
+    return MQTT_INVALID_ARGS;
+  }
+  if(MQTT_SUCCESS != (rc = mqtt_track_id( packet, &pkt_id ))) {
+    return rc;
+  }
+  if((packet->value[0] & 0x06) == 0x04) {
+    return MQTT_NOT_SUPPORTED;
+  }
+  if(NULL != id) {
+    *id = pkt_id;
+  }
+  if(!pkt_id) {
+    cb( arg, 0, MQTT_SUCCESS );
+    return MQTT_SUCCESS;
+  }
+  if(NULL == (slot = mqtt_track_free( track ))) {
+    return MQTT_NO_PKT_ID;
+  }
+
+  slot->cb = cb;
+  slot->arg = arg;
+  slot->id = pkt_id;
+  ++track->pending;
+
+  return MQTT_SUCCESS;
+}
+
+uint16_t __ATTR mqtt_track_publish(mqtt_track_t *track, const mqtt_cli_t *cli, const mqtt_publish_params_t *params, clv_t *output,
+                                   cb_mqtt_track_t cb, void *arg, uint16_t *id) {
+  lv_t packet;
+  uint16_t rc;
+
+  if(NULL == track || NULL == cli || NULL == params || NULL == output || NULL == cb) {
+    return MQTT_INVALID_ARGS;
+  }
+  if((params->flags & 0x06) == 0x04) {
+    return MQTT_NOT_SUPPORTED;
+  }
+  if((params->flags & 0x06) && NULL == mqtt_track_free( track )) {
+    return MQTT_NO_PKT_ID;
+  }
+  if(MQTT_SUCCESS != (rc = cli->publish_ex( cli, params, output ))) {
+    return rc;
+  }
+
+  packet.length = output->length;
+  packet.value = output->value;
+
+  return mqtt_track_add( track, &packet, cb, arg, id );
+}
+
+uint8_t __ATTR mqtt_track_puback(mqtt_track_t *track, const mqtt_puback_t *pkt) {
+  mqtt_track_slot_t *slot;
+  cb_mqtt_track_t cb;
+  size_t i;
+
+  for(i=0; track->pending && i<track->count; ++i) {
+    slot = &track->slots[i];
+    if(NULL == slot->cb || slot->id != pkt->id) {
+      continue;
+    }
+    /* The slot is released first, so the callback could publish the next message */
+    cb = slot->cb;
+    slot->cb = NULL;
+    --track->pending;
+    cb( slot->arg, pkt->id, (pkt->rc < 0x80) ? MQTT_SUCCESS : MQTT_PKT_REJECTED );
+    return 1;
+  }
+
+  return 0;
+}
+
+size_t __ATTR mqtt_track_fail(mqtt_track_t *track, uint16_t rc) {
+  mqtt_track_slot_t *slot;
+  cb_mqtt_track_t cb;
+  size_t i, completed = 0;
+
+  for(i=0; track->pending && i<track->count; ++i) {
+    slot = &track->slots[i];
+    if(NULL == slot->cb) {
+      continue;
+    }
+    cb = slot->cb;
+    slot->cb = NULL;
+    --track->pending;
+    ++completed;
+    cb( slot->arg, slot->id, rc );
+  }
+
+  return completed;
+}
@@ -0,0 +1,63 @@
+#include "../api/mqtt_util.h"
+
+size_t __ATTR mqtt_util_property_size(const uint8_t *buf, size_t len) {
+  size_t size;
+
+  switch(buf[0]) {
+    /* Payload Format Indicator */
+    case 0x01:
+      size = 2;
+      break;
+    /* Message Expiry Interval */
+    case 0x02:
+      size = 5;
+      break;
+    /* Topic Alias */
+    case 0x23:
+      size = 3;
+      break;
+    /* Subscription Identifier */
+    case 0x0B:
+      size = 1;
+      while(size < len && (buf[size] & 0x80)) {
+        ++size;
+      }
+      ++size;
+      break;
+    /* Content Type, Response Topic, Correlation Data */
+    case 0x03:
+    case 0x08:
+    case 0x09:
+      if(len < 3) {
+        return 0;
+      }
+      size = 3 + (((size_t) buf[1] << 8) | buf[2]);
+      break;
+    /* User Property */
+    case 0x26:
+      if(len < 3) {
+        return 0;
+      }
+      size = 3 + (((size_t) buf[1] << 8) | buf[2]);
+      if(size + 2 > len) {
+        return 0;
+      }
+      size += 2 + (((size_t) buf[size] << 8) | buf[size + 1]);
+      break;
+    default:
+      return 0;
+  }
+
+  return size > len ? 0 : size;
+}
+
+uint32_t __ATTR mqtt_util_hash(const uint8_t *buf, size_t len) {
+  uint32_t hash = 2166136261u;
+
+  while(len--) {
+    hash ^= *buf++;
+    hash *= 16777619u;
+  }
+
+  return hash;
+}